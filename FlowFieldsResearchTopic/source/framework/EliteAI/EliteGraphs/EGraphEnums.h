@@ -5,6 +5,12 @@ enum
 	invalid_node_index = -1
 };
 
+enum
+{
+	// Cost field value of a cell that can never be entered
+	impassable_cell_cost = 255
+};
+
 
 enum class TerrainType : int
 {
@@ -12,4 +18,25 @@ enum class TerrainType : int
 	Mud = 3,
 	// Node's with a value of over 200 000 are always isolated
 	Water = 200001
-};
\ No newline at end of file
+};
+
+// Converts a terrain type to the byte stored in a grid's cost field
+inline unsigned char GetTerrainCellCost(TerrainType terrain)
+{
+	if (int(terrain) > 200000)
+		return impassable_cell_cost;
+	if (int(terrain) >= impassable_cell_cost)
+		return impassable_cell_cost - 1;
+	return (unsigned char)terrain;
+}
+
+// Movement multiplier of a terrain when a grid has no entry for it in its speed table
+// A cell that costs three times as much to cross is crossed three times slower
+inline float GetTerrainDefaultSpeed(TerrainType terrain)
+{
+	const unsigned char cost = GetTerrainCellCost(terrain);
+	//impassable cells keep full speed, agents only end up there when pushed in
+	if (cost == 0 || cost == impassable_cell_cost)
+		return 1.f;
+	return 1.f / cost;
+}
\ No newline at end of file
@@ -9,17 +9,51 @@
 #include "EIGraph.h"
 #include "EGraphConnectionTypes.h"
 #include "EGraphNodeTypes.h"
+#include "EGridPolicies.h"
+#include <atomic>
+#include <mutex>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define ELITE_GRID_SSE2
+#include <emmintrin.h>
+#endif
 
 namespace Elite
 {
-	template<class T_NodeType, class T_ConnectionType>
+	// Order of the cells in memory, hidden behind GetIndex / GetNodePos
+	// Tiled stores 8x8 blocks of cells together, so vertical and diagonal neighbours mostly share cache lines
+	enum class GridLayout
+	{
+		RowMajor,
+		Tiled
+	};
+
+	// One way link between two cells that are not necessarily adjacent (teleporter, elevator, tunnel...)
+	struct PortalLink
+	{
+		int CellIdx; // the other end of the link
+		float Cost;
+	};
+
+	// Connectivity and cost model are policies (see EGridPolicies.h), the defaults are configured at runtime
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity = RuntimeConnectivity, class T_CostModel = CostFieldCost>
 	class GridGraph : public IGraph<T_NodeType, T_ConnectionType>
 	{
 	public:
-		GridGraph(int columns, int rows, int cellSize, bool isDirectionalGraph, bool isConnectedDiagonally, float costStraight = 1.f, float costDiagonal = 1.5);
-
-		using IGraph::GetNode;
-		T_NodeType* GetNode(int col, int row) const { return m_Nodes[GetIndex(col, row)]; }
+		// pExternalCostField starts the grid on an external cost field right away, see UseExternalCostField
+		GridGraph(int columns, int rows, int cellSize, bool isDirectionalGraph, bool isConnectedDiagonally, float costStraight = 1.f, float costDiagonal = 1.5, bool createConnections = true, GridLayout layout = GridLayout::RowMajor,
+			unsigned char* pExternalCostField = nullptr, const TerrainType* pTerrainOfCost = nullptr);
+		virtual ~GridGraph();
+
+		// Grids without connections create their nodes on first use, a chunk of cells at a time, so opening a large map doesn't pay for them
+		// Those nodes are not in GetAllNodes, loop over the indices instead
+		// These hide the IGraph versions, which only know the nodes in GetAllNodes, so use the grid through a GridGraph
+		T_NodeType* GetNode(int idx) const;
+		T_NodeType* GetNode(int col, int row) const { return GetNode(GetIndex(col, row)); }
+		int GetNrOfNodes() const { return m_NrOfColumns * m_NrOfRows; }
+		int GetNrOfActiveNodes() const;
+		// Terrain of a cell, without creating its node
+		TerrainType GetCellTerrain(int idx) const;
 		const ConnectionList& GetConnections(const T_NodeType& node) const { return m_Connections[node.GetIndex()]; }
 		const ConnectionList& GetConnections(int idx) const { return m_Connections[idx]; }
 
@@ -27,11 +61,13 @@ namespace Elite
 		int GetColumns() const { return m_NrOfColumns; }
 
 		bool IsWithinBounds(int col, int row) const;
-		int GetIndex(int col, int row) const { return row * m_NrOfColumns + col; }
+		int GetIndex(int col, int row) const { return m_Layout == GridLayout::RowMajor ? row * m_NrOfColumns + col : GetTiledIndex(col, row); }
+		void GetColRow(int idx, int& col, int& row) const;
+		GridLayout GetLayout() const { return m_Layout; }
 
 		// returns the column and row of the node in a Vector2
-		using IGraph::GetNodePos;
 		virtual Vector2 GetNodePos(T_NodeType* pNode) const override;
+		virtual Vector2 GetNodePos(int idx) const override;
 
 		// returns the actual world position of the node
 		Vector2 GetNodeWorldPos(int col, int row) const;
@@ -41,59 +77,204 @@ namespace Elite
 		int GetCellSize() const;
 
 		int GetNodeFromWorldPos(Vector2 pos = ZeroVector2) const;
+		// Batched lookup of count positions, four at a time with SSE2
+		// Unlike GetNodeFromWorldPos, positions outside the grid are clamped to the closest border cell
+		void GetNodesFromWorldPos(const Vector2* pPositions, size_t count, int* pCells) const;
 
+		// Reconnects a node to its passable neighbours, costs O(degree)
 		void UnIsolateNode(int idx);
+		// Batched variants for brush strokes, every node is only visited once
+		void UnIsolateNodes(const std::vector<int>& indices);
+		void SetTerrainTypes(const std::vector<int>& indices, TerrainType terrain);
+
+		// Cost field: one byte per cell, impassable_cell_cost can never be entered
+		const unsigned char* GetCostField() const { return m_pCostField; }
+		unsigned char GetCellCost(int idx) const { return m_pCostField[idx]; }
+		void SetCellCost(int idx, unsigned char cost);
+		bool IsPassable(int idx) const { return m_pCostField[idx] != impassable_cell_cost; }
+		// Changes whenever a cell's cost was written
+		unsigned int GetCostFieldVersion() const { return m_CostFieldVersion; }
+		// Backs the cost field by memory the caller keeps alive, e.g. a mapped map file, without copying it
+		// Node terrains and the speed field are rebuilt from the new costs, terrainOfCost holds the terrain of each of the 256 cost values
+		void UseExternalCostField(unsigned char* pCostField, const TerrainType* pTerrainOfCost);
+		// Copies an external cost field into the graph, so the external memory can be released
+		void UseOwnedCostField();
+		bool HasExternalCostField() const { return m_pCostField != m_OwnedCostField.data(); }
+
+		// Writes the terrain to the node, the cost field and the speed field, explicit connections are only touched when the grid has them
+		void SetTerrainType(int idx, TerrainType terrain);
+
+		// Speed field: movement multiplier per cell, looked up from the terrain speed table on terrain edits
+		const std::vector<float>& GetSpeedField() const { return m_SpeedField; }
+		float GetSpeedMultiplier(int idx) const { return m_SpeedField[idx]; }
+		// Changes whenever a cell's speed multiplier changed
+		unsigned int GetSpeedFieldVersion() const { return m_SpeedFieldVersion; }
+		float GetTerrainSpeed(TerrainType terrain) const;
+		// Overrides the default speed of a terrain and updates every cell of that terrain
+		void SetTerrainSpeed(TerrainType terrain, float speed);
+
+		// Cost of stepping between two adjacent cells, derived from the cost field
+		float GetStepCost(int fromIdx, int toIdx) const;
+		float GetDefaultCostStraight() const { return m_DefaultCostStraight; }
+		float GetDefaultCostDiagonal() const { return m_DefaultCostDiagonal; }
+		bool IsConnectedDiagonally() const { return T_Connectivity::IsFixed ? T_Connectivity::IsDiagonal : m_IsConnectedDiagionally; }
+
+		// Calls func(neighbourIdx, stepCost) for every passable neighbour, without going through connections
+		template<class T_Func>
+		void ForEachNeighbour(int idx, T_Func func) const;
+
+		// Clearance field: distance in cells from each cell center to the closest impassable cell center, FLT_MAX without any
+		// Edits that change passability mark it dirty, UpdateClearanceField rebuilds it in linear time and the field is empty until the first update
+		const std::vector<float>& GetClearanceField() const { return m_ClearanceField; }
+		float GetClearance(int idx) const { return m_ClearanceField[idx]; }
+		bool IsClearanceDirty() const { return m_IsClearanceDirty; }
+		void UpdateClearanceField();
+
+		// Portal links: extra edges on top of the neighbours, looked up per cell
+		// The flags are one byte per cell so cells without portals only pay for a single load
+		void AddPortalLink(int fromIdx, int toIdx, float cost = 0.f);
+		void RemovePortalLinks(int idx); // outgoing and incoming
+		void ClearPortalLinks();
+		bool HasPortalLinks(int idx) const { return (m_PortalFlags[idx] & ePortalOut) != 0; }
+		bool HasIncomingPortalLinks(int idx) const { return (m_PortalFlags[idx] & ePortalIn) != 0; }
+		const std::vector<PortalLink>& GetPortalLinks(int idx) const { return m_OutgoingPortalLinks.at(idx); }
+		// CellIdx of an incoming link is the cell it starts from
+		const std::vector<PortalLink>& GetIncomingPortalLinks(int idx) const { return m_IncomingPortalLinks.at(idx); }
+		const std::unordered_map<int, std::vector<PortalLink>>& GetAllPortalLinks() const { return m_OutgoingPortalLinks; }
+		// Changes whenever a portal link was added or removed
+		unsigned int GetPortalLinksVersion() const { return m_PortalLinksVersion; }
+
+		bool HasConnections() const { return m_HasConnections; }
 	private:
 		
 		int m_NrOfColumns;
 		int m_NrOfRows;
 		int m_CellSize;
+		GridLayout m_Layout;
+
+		//Tiles at the right and top border are cut off, so the indices stay dense without padding cells
+		static const int TILE_SHIFT = 3;
+		static const int TILE_SIZE = 1 << TILE_SHIFT;
+		int GetTiledIndex(int col, int row) const;
 
 		bool m_IsConnectedDiagionally;
+		bool m_HasConnections;
 		const float m_DefaultCostStraight;
 		const float m_DefaultCostDiagonal;
 
-		const vector<Vector2> m_StraightDirections = { { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 } };
-		const vector<Vector2> m_DiagonalDirections = { { 1, 1 }, { -1, 1 }, { -1, -1 }, { 1, -1 } };
+		unsigned char* m_pCostField; // points into m_OwnedCostField unless an external field is used
+		std::vector<unsigned char> m_OwnedCostField;
+		std::vector<float> m_SpeedField;
+		std::map<TerrainType, float> m_TerrainSpeeds;
+		unsigned int m_SpeedFieldVersion = 0;
+		unsigned int m_CostFieldVersion = 0;
+		unsigned int m_PortalLinksVersion = 0;
+
+		enum PortalFlags : unsigned char
+		{
+			ePortalOut = 1 << 0,
+			ePortalIn = 1 << 1
+		};
+		std::vector<unsigned char> m_PortalFlags;
+		std::unordered_map<int, std::vector<PortalLink>> m_OutgoingPortalLinks;
+		std::unordered_map<int, std::vector<PortalLink>> m_IncomingPortalLinks;
+
+		std::vector<float> m_ClearanceField;
+		bool m_IsClearanceDirty = true;
+		static void DistanceTransform1D(const float* pSource, float* pDistances, int count, int* pParabolas, float* pBounds);
+
+		//Nodes of grids without connections, the chunks are created under the lock and published atomically so lookups stay lock free
+		static const int NODE_CHUNK_SHIFT = 12;
+		static const int NODE_CHUNK_SIZE = 1 << NODE_CHUNK_SHIFT;
+		std::unique_ptr<std::atomic<T_NodeType*>[]> m_pNodeChunks;
+		int m_NrOfNodeChunks = 0;
+		mutable std::mutex m_NodeChunkMutex;
+		TerrainType m_TerrainOfCost[256]; // terrain a node gets from its cell's cost when it's created
+		T_NodeType* CreateNodeChunk(int chunk) const;
+		// Terrain and speed of every cell from its cost, for a cost field that didn't come from terrain edits
+		void ApplyTerrainOfCost(const TerrainType* pTerrainOfCost);
 
 		// graph creation helper functions
 		void AddConnectionsToAdjacentCells(int idx, int col, int row);
-		void AddConnectionsInDirections(int idx, int col, int row, vector<Vector2> directions);
+		void AddConnectionsFromAdjacentCells(int idx, int col, int row);
 
 		float GetConnectionCost(int fromIdx, int toIdx) const;
-		//void AddCheckedConnection(int idx, int neighborCol, int neighborRow, float cost);
+		// Loop free body of ForEachNeighbour, the first T_NrOfDirections directions
+		template<int T_NrOfDirections, class T_Func>
+		void ForEachNeighbourInDirections(int idx, T_Func& func) const;
+		void AddCheckedConnection(int fromIdx, int toIdx);
 
 	
 		friend class EGraphRenderer;
+
+		//C++ make the class non-copyable, the cost field pointer can't follow a copy
+		GridGraph(const GridGraph&) = delete;
+		GridGraph& operator=(const GridGraph&) = delete;
 	};
 
+	// The runtime configured grid, and grids whose connectivity is fixed at compile time
 	template<class T_NodeType, class T_ConnectionType>
-	GridGraph<T_NodeType, T_ConnectionType>::GridGraph(
+	using RuntimeGridGraph = GridGraph<T_NodeType, T_ConnectionType, RuntimeConnectivity, CostFieldCost>;
+	template<class T_NodeType, class T_ConnectionType, class T_CostModel = CostFieldCost>
+	using FourConnectedGridGraph = GridGraph<T_NodeType, T_ConnectionType, FourConnectivity, T_CostModel>;
+	template<class T_NodeType, class T_ConnectionType, class T_CostModel = CostFieldCost>
+	using EightConnectedGridGraph = GridGraph<T_NodeType, T_ConnectionType, EightConnectivity, T_CostModel>;
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::GridGraph(
 		int columns,
 		int rows, 
 		int cellSize, 
 		bool isDirectionalGraph, 
 		bool isConnectedDiagonally, 
 		float costStraight /* = 1.f*/, 
-		float costDiagonal /* = 1.5f */)
+		float costDiagonal /* = 1.5f */,
+		bool createConnections /* = true */,
+		GridLayout layout /* = GridLayout::RowMajor */,
+		unsigned char* pExternalCostField /* = nullptr */,
+		const TerrainType* pTerrainOfCost /* = nullptr */)
 		: IGraph(isDirectionalGraph)
 		, m_NrOfColumns(columns)
 		, m_NrOfRows(rows)
 		, m_CellSize(cellSize)
+		, m_Layout(layout)
 		, m_IsConnectedDiagionally(isConnectedDiagonally)
+		, m_HasConnections(createConnections)
 		, m_DefaultCostStraight(costStraight)
 		, m_DefaultCostDiagonal(costDiagonal)
+		, m_OwnedCostField(pExternalCostField ? 0 : columns * rows, GetTerrainCellCost(TerrainType::Ground))
+		, m_SpeedField(columns * rows, GetTerrainDefaultSpeed(TerrainType::Ground))
+		, m_PortalFlags(columns * rows, 0)
 	{
-		// Create all nodes
-		for (auto r = 0; r < m_NrOfRows; ++r)
+		m_pCostField = pExternalCostField ? pExternalCostField : m_OwnedCostField.data();
+		for (int cost = 0; cost < 256; ++cost)
+			m_TerrainOfCost[cost] = TerrainType::Ground;
+		m_TerrainOfCost[GetTerrainCellCost(TerrainType::Mud)] = TerrainType::Mud;
+		m_TerrainOfCost[impassable_cell_cost] = TerrainType::Water;
+
+		// Regular grids can be traversed through the cost field alone, their nodes are created when they're asked for
+		if (!m_HasConnections)
 		{
-			for (auto c = 0; c < m_NrOfColumns; ++c)
-			{
-				int idx = GetIndex(c, r);
-				AddNode(new T_NodeType(idx));
-			}
+			m_NrOfNodeChunks = (m_NrOfColumns * m_NrOfRows + NODE_CHUNK_SIZE - 1) >> NODE_CHUNK_SHIFT;
+			m_pNodeChunks.reset(new std::atomic<T_NodeType*>[m_NrOfNodeChunks]);
+			for (int chunk = 0; chunk < m_NrOfNodeChunks; ++chunk)
+				m_pNodeChunks[chunk].store(nullptr, std::memory_order_relaxed);
+			if (pExternalCostField)
+				ApplyTerrainOfCost(pTerrainOfCost);
+			return;
 		}
 
+		// Create all nodes, in index order so the node list matches the layout
+		m_Nodes.reserve(m_NrOfColumns * m_NrOfRows);
+		m_Connections.reserve(m_NrOfColumns * m_NrOfRows);
+		m_IncomingConnections.reserve(m_NrOfColumns * m_NrOfRows);
+		for (auto idx = 0; idx < m_NrOfColumns * m_NrOfRows; ++idx)
+		{
+			AddNode(new T_NodeType(idx));
+		}
+		if (pExternalCostField)
+			ApplyTerrainOfCost(pTerrainOfCost);
+
 		// Create connections in each valid direction on each node
 		for (auto r = 0; r < m_NrOfRows; ++r)
 		{
@@ -105,156 +286,550 @@ namespace Elite
 		}
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	bool GridGraph<T_NodeType, T_ConnectionType>::IsWithinBounds(int col, int row) const
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::~GridGraph()
+	{
+		for (int chunk = 0; chunk < m_NrOfNodeChunks; ++chunk)
+		{
+			T_NodeType* pChunk = m_pNodeChunks[chunk].load(std::memory_order_relaxed);
+			if (!pChunk)
+				continue;
+			const int count = std::min(NODE_CHUNK_SIZE, GetNrOfNodes() - (chunk << NODE_CHUNK_SHIFT));
+			for (int i = 0; i < count; ++i)
+				pChunk[i].~T_NodeType();
+			::operator delete(pChunk);
+		}
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	T_NodeType* GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::GetNode(int idx) const
+	{
+		assert((idx < GetNrOfNodes()) && (idx >= 0) && "<GridGraph::GetNode>: invalid index");
+		if (m_HasConnections)
+			return m_Nodes[idx];
+
+		T_NodeType* pChunk = m_pNodeChunks[idx >> NODE_CHUNK_SHIFT].load(std::memory_order_acquire);
+		if (!pChunk)
+			pChunk = CreateNodeChunk(idx >> NODE_CHUNK_SHIFT);
+		return pChunk + (idx & (NODE_CHUNK_SIZE - 1));
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	T_NodeType* GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::CreateNodeChunk(int chunk) const
+	{
+		std::lock_guard<std::mutex> lock{ m_NodeChunkMutex };
+		T_NodeType* pChunk = m_pNodeChunks[chunk].load(std::memory_order_relaxed);
+		if (pChunk)
+			return pChunk; //another thread created it while this one waited
+
+		const int first = chunk << NODE_CHUNK_SHIFT;
+		const int count = std::min(NODE_CHUNK_SIZE, GetNrOfNodes() - first);
+		pChunk = static_cast<T_NodeType*>(::operator new(count * sizeof(T_NodeType)));
+		for (int i = 0; i < count; ++i)
+		{
+			new (pChunk + i) T_NodeType(first + i);
+			pChunk[i].SetTerrainType(m_TerrainOfCost[m_pCostField[first + i]]);
+		}
+		m_pNodeChunks[chunk].store(pChunk, std::memory_order_release);
+		return pChunk;
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	int GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::GetNrOfActiveNodes() const
+	{
+		//nodes that are created on use are never removed
+		return m_HasConnections ? IGraph<T_NodeType, T_ConnectionType>::GetNrOfActiveNodes() : GetNrOfNodes();
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	TerrainType GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::GetCellTerrain(int idx) const
+	{
+		if (m_HasConnections)
+			return m_Nodes[idx]->GetTerrainType();
+
+		const T_NodeType* pChunk = m_pNodeChunks[idx >> NODE_CHUNK_SHIFT].load(std::memory_order_acquire);
+		return pChunk ? pChunk[idx & (NODE_CHUNK_SIZE - 1)].GetTerrainType() : m_TerrainOfCost[m_pCostField[idx]];
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	bool GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::IsWithinBounds(int col, int row) const
 	{
 		return (col >= 0 && col < m_NrOfColumns && row >= 0 && row < m_NrOfRows);
 	}
 
 
-	template<class T_NodeType, class T_ConnectionType>
-	void GridGraph<T_NodeType, T_ConnectionType>::AddConnectionsToAdjacentCells(int idx, int col, int row)
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	void GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::AddConnectionsToAdjacentCells(int idx, int col, int row)
 	{
 		// Add connections in all directions, taking into account the dimensions of the grid
-		AddConnectionsInDirections(idx, col, row, m_StraightDirections);
-
-		if (m_IsConnectedDiagionally)
+		const int nrOfDirections = IsConnectedDiagonally() ? NR_OF_GRID_DIRECTIONS : NR_OF_GRID_DIRECTIONS / 2;
+		for (int d = 0; d < nrOfDirections; ++d)
 		{
-			AddConnectionsInDirections(idx, col, row, m_DiagonalDirections);
+			const int neighborCol = col + GetGridDirectionCol(d);
+			const int neighborRow = row + GetGridDirectionRow(d);
+			if (IsWithinBounds(neighborCol, neighborRow))
+			{
+				AddCheckedConnection(idx, GetIndex(neighborCol, neighborRow));
+			}
 		}
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	void GridGraph<T_NodeType, T_ConnectionType>::UnIsolateNode(int idx)
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	void GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::UnIsolateNode(int idx)
 	{
 		//Isolate it to make sure it was isolated
 		IsolateNode(idx);
 
-		//Add connections from this node to the neighbouring nodes
+		//Add connections from this node to the neighbouring nodes (and back on undirected graphs)
 		Vector2 rowCol = GetNodePos(idx);
 		AddConnectionsToAdjacentCells(idx, (int)rowCol.x, (int)rowCol.y);
 
-		//Add connections to the neigbouring nodes to this node
-		for (auto d : m_StraightDirections)
+		//Add connections from the neighbouring nodes to this node, only the neighbours can have one
+		if (m_IsDirectionalGraph)
 		{
-			int neighborCol = (int)rowCol.x + (int)d.x;
-			int neighborRow = (int)rowCol.y + (int)d.y;
-			int neighborIdx = neighborRow * m_NrOfColumns + neighborCol;
-			if (IsWithinBounds(neighborCol, neighborRow))
+			AddConnectionsFromAdjacentCells(idx, (int)rowCol.x, (int)rowCol.y);
+		}
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	void GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::UnIsolateNodes(const std::vector<int>& indices)
+	{
+		//Isolate everything first so connections made between two nodes of the batch are not removed again
+		IsolateNodes(indices);
+
+		for (int idx : indices)
+		{
+			Vector2 rowCol = GetNodePos(idx);
+			AddConnectionsToAdjacentCells(idx, (int)rowCol.x, (int)rowCol.y);
+			if (m_IsDirectionalGraph)
 			{
-				AddConnectionsToAdjacentCells(neighborIdx, neighborCol, neighborRow);
+				AddConnectionsFromAdjacentCells(idx, (int)rowCol.x, (int)rowCol.y);
 			}
 		}
+	}
 
-		if (m_IsConnectedDiagionally)
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	void GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::AddConnectionsFromAdjacentCells(int idx, int col, int row)
+	{
+		const int nrOfDirections = IsConnectedDiagonally() ? NR_OF_GRID_DIRECTIONS : NR_OF_GRID_DIRECTIONS / 2;
+		for (int d = 0; d < nrOfDirections; ++d)
 		{
-			for (auto d : m_DiagonalDirections)
+			const int neighborCol = col + GetGridDirectionCol(d);
+			const int neighborRow = row + GetGridDirectionRow(d);
+			if (IsWithinBounds(neighborCol, neighborRow))
 			{
-				int neighborCol = (int)rowCol.x + (int)d.x;
-				int neighborRow = (int)rowCol.y + (int)d.y;
-				int neighborIdx = neighborRow * m_NrOfColumns + neighborCol;
-				if (IsWithinBounds(neighborCol, neighborRow))
-				{
-					AddConnectionsToAdjacentCells(neighborIdx, neighborCol, neighborRow);
-				}
+				AddCheckedConnection(GetIndex(neighborCol, neighborRow), idx);
 			}
 		}
+	}
 
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	void GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::AddCheckedConnection(int fromIdx, int toIdx)
+	{
+		if (IsPassable(fromIdx) && IsPassable(toIdx)
+			&& IsUniqueConnection(fromIdx, toIdx))
+			AddConnection(new GraphConnection(fromIdx, toIdx, GetConnectionCost(fromIdx, toIdx)));
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	void GridGraph<T_NodeType, T_ConnectionType>::AddConnectionsInDirections(int idx, int col, int row, vector<Elite::Vector2> directions)
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	inline float GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::GetConnectionCost(int fromIdx, int toIdx) const
 	{
-		for (auto d : directions)
+		return GetStepCost(fromIdx, toIdx);
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	inline float GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::GetStepCost(int fromIdx, int toIdx) const
+	{
+		float cost = m_DefaultCostStraight;
+
+		int fromCol, fromRow, toCol, toRow;
+		GetColRow(fromIdx, fromCol, fromRow);
+		GetColRow(toIdx, toCol, toRow);
+		if (fromCol != toCol && fromRow != toRow)
 		{
-			int neighborCol = col + (int)d.x;
-			int neighborRow = row + (int)d.y;
-			
-			if (IsWithinBounds(neighborCol, neighborRow)) 
-			{
-				int neighborIdx = neighborRow * m_NrOfColumns + neighborCol;
-				float connectionCost = GetConnectionCost(idx, neighborIdx);
+			cost = m_DefaultCostDiagonal;
+		}
 
-				if (IsUniqueConnection(idx, neighborIdx) 
-					&& connectionCost < 100000) //Extra check for different terrain types
-					AddConnection(new GraphConnection(idx, neighborIdx, connectionCost));
-			}
+		return T_CostModel::GetStepCost(cost, m_pCostField[fromIdx], m_pCostField[toIdx]);
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	inline void GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::SetCellCost(int idx, unsigned char cost)
+	{
+		m_IsClearanceDirty |= (cost == impassable_cell_cost) != (m_pCostField[idx] == impassable_cell_cost);
+		m_pCostField[idx] = cost;
+		++m_CostFieldVersion;
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	inline void GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::SetTerrainType(int idx, TerrainType terrain)
+	{
+		GetNode(idx)->SetTerrainType(terrain);
+		m_IsClearanceDirty |= (GetTerrainCellCost(terrain) == impassable_cell_cost) != !IsPassable(idx);
+		m_pCostField[idx] = GetTerrainCellCost(terrain);
+		m_SpeedField[idx] = GetTerrainSpeed(terrain);
+		++m_SpeedFieldVersion;
+		++m_CostFieldVersion;
+
+		if (!m_HasConnections)
+			return;
+
+		if (IsPassable(idx))
+			UnIsolateNode(idx);
+		else
+			IsolateNode(idx);
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	inline void GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::SetTerrainTypes(const std::vector<int>& indices, TerrainType terrain)
+	{
+		const unsigned char cost = GetTerrainCellCost(terrain);
+		const float speed = GetTerrainSpeed(terrain);
+		for (int idx : indices)
+		{
+			GetNode(idx)->SetTerrainType(terrain);
+			m_IsClearanceDirty |= (cost == impassable_cell_cost) != !IsPassable(idx);
+			m_pCostField[idx] = cost;
+			m_SpeedField[idx] = speed;
 		}
+		++m_SpeedFieldVersion;
+		++m_CostFieldVersion;
+
+		if (!m_HasConnections)
+			return;
+
+		if (GetTerrainCellCost(terrain) != impassable_cell_cost)
+			UnIsolateNodes(indices);
+		else
+			IsolateNodes(indices);
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline float GridGraph<T_NodeType, T_ConnectionType>::GetConnectionCost(int fromIdx, int toIdx) const
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	inline void GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::UseExternalCostField(unsigned char* pCostField, const TerrainType* pTerrainOfCost)
 	{
-		float cost = m_DefaultCostStraight;
+		m_pCostField = pCostField;
+		m_OwnedCostField.clear();
+		m_OwnedCostField.shrink_to_fit();
+		ApplyTerrainOfCost(pTerrainOfCost);
+		++m_CostFieldVersion;
+		m_IsClearanceDirty = true;
 
-		Vector2 fromPos = GetNodePos(fromIdx);
-		Vector2 toPos = GetNodePos(toIdx);
+		if (!m_HasConnections)
+			return;
 
-		if (int(fromPos.y) != int(toPos.y) &&
-			int(fromPos.x) != int(toPos.x))
+		for (int idx = 0; idx < GetNrOfNodes(); ++idx)
 		{
-			cost = m_DefaultCostDiagonal;
+			if (IsPassable(idx))
+				UnIsolateNode(idx);
+			else
+				IsolateNode(idx);
 		}
+	}
 
-		return cost;
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	inline void GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::ApplyTerrainOfCost(const TerrainType* pTerrainOfCost)
+	{
+		float speedOfCost[256];
+		for (int cost = 0; cost < 256; ++cost)
+		{
+			m_TerrainOfCost[cost] = pTerrainOfCost[cost];
+			speedOfCost[cost] = GetTerrainSpeed(pTerrainOfCost[cost]);
+		}
+		for (int idx = 0; idx < GetNrOfNodes(); ++idx)
+		{
+			m_SpeedField[idx] = speedOfCost[m_pCostField[idx]];
+		}
+		//only nodes that exist already, the others take their terrain from the table when they're created
+		for (int idx = 0; idx < int(m_Nodes.size()); ++idx)
+		{
+			m_Nodes[idx]->SetTerrainType(pTerrainOfCost[m_pCostField[idx]]);
+		}
+		for (int chunk = 0; chunk < m_NrOfNodeChunks; ++chunk)
+		{
+			T_NodeType* pChunk = m_pNodeChunks[chunk].load(std::memory_order_acquire);
+			const int first = chunk << NODE_CHUNK_SHIFT;
+			for (int i = 0; pChunk && i < std::min(NODE_CHUNK_SIZE, GetNrOfNodes() - first); ++i)
+				pChunk[i].SetTerrainType(pTerrainOfCost[m_pCostField[first + i]]);
+		}
+		++m_SpeedFieldVersion;
 	}
 
-	template<>
-	inline float GridGraph<GridTerrainNode, GraphConnection>::GetConnectionCost(int fromIdx, int toIdx) const
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	inline void GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::UseOwnedCostField()
 	{
-		float cost = m_DefaultCostStraight;
+		if (!HasExternalCostField())
+			return;
+
+		m_OwnedCostField.assign(m_pCostField, m_pCostField + GetNrOfNodes());
+		m_pCostField = m_OwnedCostField.data();
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	inline float GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::GetTerrainSpeed(TerrainType terrain) const
+	{
+		auto it = m_TerrainSpeeds.find(terrain);
+		return it != m_TerrainSpeeds.end() ? it->second : GetTerrainDefaultSpeed(terrain);
+	}
 
-		Vector2 fromPos = GetNodePos(fromIdx);
-		Vector2 toPos = GetNodePos(toIdx);
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	inline void GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::SetTerrainSpeed(TerrainType terrain, float speed)
+	{
+		m_TerrainSpeeds[terrain] = speed;
+		for (int idx = 0; idx < int(m_SpeedField.size()); ++idx)
+		{
+			if (GetCellTerrain(idx) == terrain)
+				m_SpeedField[idx] = speed;
+		}
+		++m_SpeedFieldVersion;
+	}
 
-		if (int(fromPos.y) != int(toPos.y) &&
-			int(fromPos.x) != int(toPos.x))
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	inline void GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::UpdateClearanceField()
+	{
+		if (!m_IsClearanceDirty)
+			return;
+		m_IsClearanceDirty = false;
+
+		//Exact euclidean distance transform (Felzenszwalb & Huttenlocher): squared distances per column, then per row
+		const float infinity = 1e20f;
+		const int maxCount = std::max(m_NrOfColumns, m_NrOfRows);
+		std::vector<float> source(maxCount);
+		std::vector<float> distances(maxCount);
+		std::vector<int> parabolas(maxCount);
+		std::vector<float> bounds(maxCount + 1);
+		m_ClearanceField.resize(GetNrOfNodes());
+		for (int idx = 0; idx < GetNrOfNodes(); ++idx)
 		{
-			cost = m_DefaultCostDiagonal;
+			m_ClearanceField[idx] = IsPassable(idx) ? infinity : 0.f;
+		}
+
+		for (int c = 0; c < m_NrOfColumns; ++c)
+		{
+			for (int r = 0; r < m_NrOfRows; ++r)
+				source[r] = m_ClearanceField[GetIndex(c, r)];
+			DistanceTransform1D(source.data(), distances.data(), m_NrOfRows, parabolas.data(), bounds.data());
+			for (int r = 0; r < m_NrOfRows; ++r)
+				m_ClearanceField[GetIndex(c, r)] = distances[r];
+		}
+		for (int r = 0; r < m_NrOfRows; ++r)
+		{
+			for (int c = 0; c < m_NrOfColumns; ++c)
+				source[c] = m_ClearanceField[GetIndex(c, r)];
+			DistanceTransform1D(source.data(), distances.data(), m_NrOfColumns, parabolas.data(), bounds.data());
+			for (int c = 0; c < m_NrOfColumns; ++c)
+				m_ClearanceField[GetIndex(c, r)] = distances[c];
+		}
+
+		for (float& clearance : m_ClearanceField)
+		{
+			clearance = clearance >= infinity ? FLT_MAX : sqrtf(clearance);
+		}
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	inline void GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::DistanceTransform1D(const float* pSource, float* pDistances, int count, int* pParabolas, float* pBounds)
+	{
+		//lower envelope of the parabolas rooted at every sample
+		const float infinity = 1e20f;
+		int k = 0;
+		pParabolas[0] = 0;
+		pBounds[0] = -infinity;
+		pBounds[1] = infinity;
+		for (int q = 1; q < count; ++q)
+		{
+			auto intersect = [pSource, pParabolas, q](int k) { const int v = pParabolas[k]; return ((pSource[q] + q * q) - (pSource[v] + v * v)) / (2.f * q - 2.f * v); };
+			float s = intersect(k);
+			while (s <= pBounds[k])
+			{
+				--k;
+				s = intersect(k);
+			}
+			++k;
+			pParabolas[k] = q;
+			pBounds[k] = s;
+			pBounds[k + 1] = infinity;
 		}
 
-		cost *= (int(GetNode(fromIdx)->GetTerrainType()) + int(GetNode(toIdx)->GetTerrainType())) / 2.0f;
+		k = 0;
+		for (int q = 0; q < count; ++q)
+		{
+			while (pBounds[k + 1] < q)
+				++k;
+			const int v = pParabolas[k];
+			pDistances[q] = float((q - v) * (q - v)) + pSource[v];
+		}
+	}
 
-		return cost;
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	inline void GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::AddPortalLink(int fromIdx, int toIdx, float cost)
+	{
+		m_OutgoingPortalLinks[fromIdx].push_back(PortalLink{ toIdx, cost });
+		m_IncomingPortalLinks[toIdx].push_back(PortalLink{ fromIdx, cost });
+		m_PortalFlags[fromIdx] |= ePortalOut;
+		m_PortalFlags[toIdx] |= ePortalIn;
+		++m_PortalLinksVersion;
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	Elite::Vector2 GridGraph<T_NodeType, T_ConnectionType>::GetNodePos(T_NodeType* pNode) const
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	inline void GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::RemovePortalLinks(int idx)
 	{
-		auto col = pNode->GetIndex() % m_NrOfColumns;
-		auto row = pNode->GetIndex() / m_NrOfColumns;
+		++m_PortalLinksVersion;
+		//the other ends lose their side of the link too
+		auto removeLinks = [this](std::unordered_map<int, std::vector<PortalLink>>& links, int cellIdx, int otherIdx, PortalFlags flag)
+		{
+			auto it = links.find(otherIdx);
+			if (it == links.end())
+				return;
+			std::vector<PortalLink>& otherLinks = it->second;
+			otherLinks.erase(std::remove_if(otherLinks.begin(), otherLinks.end(), [cellIdx](const PortalLink& link) { return link.CellIdx == cellIdx; }), otherLinks.end());
+			if (otherLinks.empty())
+			{
+				links.erase(it);
+				m_PortalFlags[otherIdx] &= ~flag;
+			}
+		};
+
+		auto outIt = m_OutgoingPortalLinks.find(idx);
+		if (outIt != m_OutgoingPortalLinks.end())
+		{
+			for (const PortalLink& link : outIt->second)
+				removeLinks(m_IncomingPortalLinks, idx, link.CellIdx, ePortalIn);
+			m_OutgoingPortalLinks.erase(idx);
+		}
+
+		auto inIt = m_IncomingPortalLinks.find(idx);
+		if (inIt != m_IncomingPortalLinks.end())
+		{
+			for (const PortalLink& link : inIt->second)
+				removeLinks(m_OutgoingPortalLinks, idx, link.CellIdx, ePortalOut);
+			m_IncomingPortalLinks.erase(idx);
+		}
+		m_PortalFlags[idx] = 0;
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	inline void GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::ClearPortalLinks()
+	{
+		m_OutgoingPortalLinks.clear();
+		m_IncomingPortalLinks.clear();
+		std::fill(m_PortalFlags.begin(), m_PortalFlags.end(), (unsigned char)0);
+		++m_PortalLinksVersion;
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	template<class T_Func>
+	inline void GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::ForEachNeighbour(int idx, T_Func func) const
+	{
+		//a single branch per cell, fixed connectivity folds it away
+		if (IsConnectedDiagonally())
+			ForEachNeighbourInDirections<NR_OF_GRID_DIRECTIONS>(idx, func);
+		else
+			ForEachNeighbourInDirections<NR_OF_GRID_DIRECTIONS / 2>(idx, func);
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	template<int T_NrOfDirections, class T_Func>
+	inline void GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::ForEachNeighbourInDirections(int idx, T_Func& func) const
+	{
+		int col, row;
+		GetColRow(idx, col, row);
+		const unsigned char cost = m_pCostField[idx];
+		auto visitDirection = [this, idx, col, row, cost, &func](auto direction)
+		{
+			const int d = decltype(direction)::value;
+			const int neighbourCol = col + GetGridDirectionCol(d);
+			const int neighbourRow = row + GetGridDirectionRow(d);
+			if (!IsWithinBounds(neighbourCol, neighbourRow))
+				return;
+
+			const int neighbourIdx = GetIndex(neighbourCol, neighbourRow);
+			if (!IsPassable(neighbourIdx))
+				return;
+
+			const float baseCost = d < NR_OF_GRID_DIRECTIONS / 2 ? m_DefaultCostStraight : m_DefaultCostDiagonal;
+			func(neighbourIdx, T_CostModel::GetStepCost(baseCost, cost, m_pCostField[neighbourIdx]));
+		};
+		GridDirectionUnroller<0, T_NrOfDirections>::Run(visitDirection);
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	Elite::Vector2 GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::GetNodePos(T_NodeType* pNode) const
+	{
+		int col, row;
+		GetColRow(pNode->GetIndex(), col, row);
 
 		return Vector2{ float(col), float(row) };
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	Elite::Vector2 GridGraph<T_NodeType, T_ConnectionType>::GetNodeWorldPos(int col, int row) const
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	Elite::Vector2 GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::GetNodePos(int idx) const
+	{
+		int col, row;
+		GetColRow(idx, col, row);
+
+		return Vector2{ float(col), float(row) };
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	inline void GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::GetColRow(int idx, int& col, int& row) const
+	{
+		if (m_Layout == GridLayout::RowMajor)
+		{
+			col = idx % m_NrOfColumns;
+			row = idx / m_NrOfColumns;
+			return;
+		}
+
+		//band of tile rows, then the tile within the band, then the cell within the tile
+		const int tileRow = idx / (m_NrOfColumns << TILE_SHIFT);
+		int remainder = idx - tileRow * (m_NrOfColumns << TILE_SHIFT);
+		const int tileHeight = std::min(TILE_SIZE, m_NrOfRows - (tileRow << TILE_SHIFT));
+		const int tileCol = remainder / (tileHeight << TILE_SHIFT);
+		remainder -= tileCol * (tileHeight << TILE_SHIFT);
+		const int tileWidth = std::min(TILE_SIZE, m_NrOfColumns - (tileCol << TILE_SHIFT));
+		row = (tileRow << TILE_SHIFT) + remainder / tileWidth;
+		col = (tileCol << TILE_SHIFT) + remainder % tileWidth;
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	inline int GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::GetTiledIndex(int col, int row) const
+	{
+		const int tileRow = row >> TILE_SHIFT;
+		const int tileCol = col >> TILE_SHIFT;
+		const int tileHeight = std::min(TILE_SIZE, m_NrOfRows - (tileRow << TILE_SHIFT));
+		const int tileWidth = std::min(TILE_SIZE, m_NrOfColumns - (tileCol << TILE_SHIFT));
+		return (tileRow << TILE_SHIFT) * m_NrOfColumns + (tileCol << TILE_SHIFT) * tileHeight
+			+ (row & (TILE_SIZE - 1)) * tileWidth + (col & (TILE_SIZE - 1));
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	Elite::Vector2 GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::GetNodeWorldPos(int col, int row) const
 	{
 		Vector2 cellCenterOffset = { m_CellSize / 2.f, m_CellSize / 2.f };
 		return Vector2{ (float)col * m_CellSize, (float)row * m_CellSize } +cellCenterOffset;
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	Elite::Vector2 GridGraph<T_NodeType, T_ConnectionType>::GetNodeWorldPos(int idx) const
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	Elite::Vector2 GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::GetNodeWorldPos(int idx) const
 	{
 		auto colRow = GetNodePos(idx);
 		return GetNodeWorldPos((int)colRow.x, (int)colRow.y);
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	Elite::Vector2 GridGraph<T_NodeType, T_ConnectionType>::GetNodeWorldPos(T_NodeType* pNode) const
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	Elite::Vector2 GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::GetNodeWorldPos(T_NodeType* pNode) const
 	{
 		return GetNodeWorldPos(pNode->GetIndex());
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline int GridGraph<T_NodeType, T_ConnectionType>::GetCellSize() const
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	inline int GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::GetCellSize() const
 	{
 		return m_CellSize;
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline int GridGraph<T_NodeType, T_ConnectionType>::GetNodeFromWorldPos(Vector2 pos) const
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	inline int GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::GetNodeFromWorldPos(Vector2 pos) const
 	{
 		int idx = invalid_node_index;
 
@@ -275,4 +850,46 @@ namespace Elite
 
 		return GetIndex(c, r);
 	}
-}
\ No newline at end of file
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	void GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>::GetNodesFromWorldPos(const Vector2* pPositions, size_t count, int* pCells) const
+	{
+		//clamping happens on the floats, so far away positions can't overflow the int conversion
+		const float invCellSize = 1.f / m_CellSize;
+		const float maxCol = float(m_NrOfColumns - 1);
+		const float maxRow = float(m_NrOfRows - 1);
+
+		size_t i = 0;
+#ifdef ELITE_GRID_SSE2
+		const __m128 invCellSize4 = _mm_set1_ps(invCellSize);
+		const __m128 zero4 = _mm_setzero_ps();
+		const __m128 maxCol4 = _mm_set1_ps(maxCol);
+		const __m128 maxRow4 = _mm_set1_ps(maxRow);
+		const __m128 columns4 = _mm_set1_ps(float(m_NrOfColumns));
+		//only the row major index is cheap enough to vectorize, tiled grids take the scalar loop below
+		for (; i + 4 <= count && m_Layout == GridLayout::RowMajor; i += 4)
+		{
+			//two loads of interleaved x,y pairs, split into four x and four y values
+			const __m128 xy01 = _mm_loadu_ps(&pPositions[i].x);
+			const __m128 xy23 = _mm_loadu_ps(&pPositions[i + 2].x);
+			const __m128 x = _mm_shuffle_ps(xy01, xy23, _MM_SHUFFLE(2, 0, 2, 0));
+			const __m128 y = _mm_shuffle_ps(xy01, xy23, _MM_SHUFFLE(3, 1, 3, 1));
+
+			const __m128 col = _mm_min_ps(_mm_max_ps(_mm_mul_ps(x, invCellSize4), zero4), maxCol4);
+			const __m128 row = _mm_min_ps(_mm_max_ps(_mm_mul_ps(y, invCellSize4), zero4), maxRow4);
+
+			//SSE2 has no 32 bit integer multiply, the index is computed on whole floats instead (exact below 2^24 cells)
+			const __m128 colFloored = _mm_cvtepi32_ps(_mm_cvttps_epi32(col));
+			const __m128 rowFloored = _mm_cvtepi32_ps(_mm_cvttps_epi32(row));
+			const __m128i idx = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(rowFloored, columns4), colFloored));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(pCells + i), idx);
+		}
+#endif
+		for (; i < count; ++i)
+		{
+			const int col = int(std::min(std::max(pPositions[i].x * invCellSize, 0.f), maxCol));
+			const int row = int(std::min(std::max(pPositions[i].y * invCellSize, 0.f), maxRow));
+			pCells[i] = GetIndex(col, row);
+		}
+	}
+}
@@ -0,0 +1,68 @@
+/*=============================================================================*/
+// EGridPolicies.h: compile time policies of GridGraph. The defaults keep the
+// runtime configured behaviour, fixed policies let the neighbour loops and step
+// costs fold into constants.
+/*=============================================================================*/
+#pragma once
+
+namespace Elite
+{
+	// Neighbour directions, the four straight ones first so 4-connected grids use the first half
+	static const int NR_OF_GRID_DIRECTIONS = 8;
+	constexpr int GetGridDirectionCol(int direction)
+	{
+		return direction == 0 || direction == 4 || direction == 7 ? 1 : (direction == 1 || direction == 3 ? 0 : -1);
+	}
+	constexpr int GetGridDirectionRow(int direction)
+	{
+		return direction == 1 || direction == 4 || direction == 5 ? 1 : (direction == 0 || direction == 2 ? 0 : -1);
+	}
+
+	// Connectivity policies: fixed ones ignore the isConnectedDiagonally flag of the grid
+	struct RuntimeConnectivity
+	{
+		static const bool IsFixed = false;
+		static const bool IsDiagonal = false;
+	};
+	struct FourConnectivity
+	{
+		static const bool IsFixed = true;
+		static const bool IsDiagonal = false;
+	};
+	struct EightConnectivity
+	{
+		static const bool IsFixed = true;
+		static const bool IsDiagonal = true;
+	};
+
+	// Cost policies: cost of a step between two adjacent passable cells, from the base cost of the direction and both cost field bytes
+	struct CostFieldCost
+	{
+		static const bool UsesCostField = true;
+		static float GetStepCost(float baseCost, unsigned char fromCost, unsigned char toCost) { return baseCost * (fromCost + toCost) / 2.0f; }
+	};
+	// The cost field only decides what is passable
+	struct UniformCost
+	{
+		static const bool UsesCostField = false;
+		static float GetStepCost(float baseCost, unsigned char, unsigned char) { return baseCost; }
+	};
+
+	// Calls func(std::integral_constant<int, direction>) for every direction in [T_First, T_Last), without a loop
+	template<int T_First, int T_Last>
+	struct GridDirectionUnroller
+	{
+		template<class T_Func>
+		static void Run(T_Func& func)
+		{
+			func(std::integral_constant<int, T_First>());
+			GridDirectionUnroller<T_First + 1, T_Last>::Run(func);
+		}
+	};
+	template<int T_Last>
+	struct GridDirectionUnroller<T_Last, T_Last>
+	{
+		template<class T_Func>
+		static void Run(T_Func&) {}
+	};
+}
@@ -21,6 +21,7 @@ namespace Elite
 		using NodeVector = std::vector<T_NodeType*>;
 		using ConnectionList = std::list<T_ConnectionType*>; // TODO: function definition doesn't recognize this?
 		using ConnectionListVector = std::vector<ConnectionList>;
+		using IncomingList = std::vector<int>; // indices of the nodes that have a connection to a node
 
 	public:
 		IGraph(bool isDirectionalGraph);
@@ -48,8 +49,10 @@ namespace Elite
 		void RemoveConnection(int from, int to);
 		void RemoveConnection(T_ConnectionType* pConnection);
 
-		// Removes all connections to this pNode
+		// Removes all connections to this pNode, costs O(degree) through the incoming lists
 		void IsolateNode(int idx);
+		void IsolateNodes(const std::vector<int>& indices);
+		const IncomingList& GetIncomingConnections(int idx) const { return m_IncomingConnections[idx]; }
 
 		void SetConnectionCost(int from, int to, float cost);
 
@@ -78,12 +81,15 @@ namespace Elite
 		// A vector of adjacency pConnection lists, mapped to the indices of the nodes
 		// m_Edges[0] returns the list of connections of the pNode with index 0
 		ConnectionListVector m_Connections;
+		// Reverse adjacency, m_IncomingConnections[i] holds the 'from' index of every connection pointing at node i
+		std::vector<IncomingList> m_IncomingConnections;
 		NodeVector m_Nodes;
 
 		bool m_IsDirectionalGraph;
 
 		// protected functions
 		bool IsUniqueConnection(int from, int to) const;
+		void RemoveIncomingConnection(int from, int to);
 
 	private:
 		int m_NextNodeIndex;
@@ -121,6 +127,7 @@ namespace Elite
 				newList.push_back(new T_ConnectionType(*c));
 			m_Connections.push_back(newList);
 		}
+		m_IncomingConnections = other.m_IncomingConnections;
 
 		m_IsDirectionalGraph = other.m_IsDirectionalGraph;
 		m_NextNodeIndex = other.m_NextNodeIndex;
@@ -215,6 +222,7 @@ namespace Elite
 
 			m_Nodes.push_back(pNode);
 			m_Connections.push_back(ConnectionList());
+			m_IncomingConnections.push_back(IncomingList());
 
 			return m_NextNodeIndex++;
 		}
@@ -257,8 +265,12 @@ namespace Elite
 
 			//finally, clear this pNode's connections
 			for (auto& connection : m_Connections[node])
-					SAFE_DELETE(connection);
+			{
+				RemoveIncomingConnection(node, connection->GetTo());
+				SAFE_DELETE(connection);
+			}
 			m_Connections[node].clear();
+			m_IncomingConnections[node].clear();
 		}
 	}
 
@@ -277,6 +289,7 @@ namespace Elite
 			assert(IsUniqueConnection(pConnection->GetFrom(), pConnection->GetTo()) && "Connection already exists on this graph");
 			
 			m_Connections[pConnection->GetFrom()].push_back(pConnection);
+			m_IncomingConnections[pConnection->GetTo()].push_back(pConnection->GetFrom());
 
 			//if the graph is undirected we must add another pConnection in the opposite
 			//direction
@@ -292,6 +305,7 @@ namespace Elite
 					oppositeDirEdge->SetFrom(pConnection->GetTo());
 
 					m_Connections[pConnection->GetTo()].push_back(oppositeDirEdge);
+					m_IncomingConnections[pConnection->GetFrom()].push_back(pConnection->GetTo());
 				}
 			}
 		}
@@ -316,6 +330,7 @@ namespace Elite
 				if ((*curEdge)->GetTo() == from) 
 				{ 
 					curEdge = m_Connections[to].erase(curEdge); 
+					RemoveIncomingConnection(to, from);
 					break; 
 				}
 			}
@@ -328,12 +343,15 @@ namespace Elite
 			if ((*curEdge)->GetTo() == to) 
 			{ 
 				curEdge = m_Connections[from].erase(curEdge); 
+				RemoveIncomingConnection(from, to);
 				break; 
 			}
 		}
 
 		SAFE_DELETE(conFromTo);
-		SAFE_DELETE(conToFrom);
+		//on a directional graph the opposite connection is independent and stays in the graph
+		if (!m_IsDirectionalGraph)
+			SAFE_DELETE(conToFrom);
 
 	}
 
@@ -348,13 +366,17 @@ namespace Elite
 	{
 		// remove and delete connections from this pNode
 		for (auto c : m_Connections[idx])
+		{
+			RemoveIncomingConnection(idx, c->GetTo());
 			delete c;
+		}
 		m_Connections[idx].clear();
 
-		// remove and delete connections from other nodes to this pNode
+		// remove and delete connections from other nodes to this pNode, only the nodes in the incoming list can have one
 		auto isConnectionToThisNode = [idx](T_ConnectionType* pCon) { return pCon->GetTo() == idx; };
-		for (auto& c : m_Connections)
+		for (int from : m_IncomingConnections[idx])
 		{
+			auto& c = m_Connections[from];
 			list<T_ConnectionType*>::iterator foundIt;
 			while ((foundIt = std::find_if(c.begin(), c.end(), isConnectionToThisNode))	!= c.end())
 			{
@@ -362,6 +384,14 @@ namespace Elite
 				c.erase(foundIt);
 			}
 		}
+		m_IncomingConnections[idx].clear();
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	inline void IGraph<T_NodeType, T_ConnectionType>::IsolateNodes(const std::vector<int>& indices)
+	{
+		for (int idx : indices)
+			IsolateNode(idx);
 	}
 
 	template<class T_NodeType, class T_ConnectionType>
@@ -417,6 +447,7 @@ namespace Elite
 		m_NextNodeIndex = 0;
 		m_Nodes.clear();
 		m_Connections.clear();
+		m_IncomingConnections.clear();
 	}
 
 	template<class T_NodeType, class T_ConnectionType>
@@ -424,6 +455,8 @@ namespace Elite
 	{
 		for (auto& connectionList : m_Connections)
 			connectionList.clear();
+		for (auto& incomingList : m_IncomingConnections)
+			incomingList.clear();
 	}
 
 	template<class T_NodeType, class T_ConnectionType>
@@ -487,6 +520,18 @@ namespace Elite
 		return true;
 	}
 
+	template<class T_NodeType, class T_ConnectionType>
+	inline void IGraph<T_NodeType, T_ConnectionType>::RemoveIncomingConnection(int from, int to)
+	{
+		auto& incoming = m_IncomingConnections[to];
+		auto foundIt = std::find(incoming.begin(), incoming.end(), from);
+		if (foundIt != incoming.end())
+		{
+			*foundIt = incoming.back();
+			incoming.pop_back();
+		}
+	}
+
 	template<class T_NodeType, class T_ConnectionType>
 	inline void IGraph<T_NodeType, T_ConnectionType>::CullInvalidEdges()
 	{
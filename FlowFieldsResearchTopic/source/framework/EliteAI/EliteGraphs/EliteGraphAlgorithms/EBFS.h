@@ -23,7 +23,9 @@ namespace Elite
 	std::vector<T_NodeType*> BFS<T_NodeType, T_ConnectionType>::FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode)
 	{
 		std::queue<T_NodeType*> openList;
-		std::map<T_NodeType*, T_NodeType*> closedList;
+		//parent index per node, invalid_node_index while a node hasn't been reached
+		std::vector<int> parents(m_pGraph->GetNrOfNodes(), invalid_node_index);
+		parents[pStartNode->GetIndex()] = pStartNode->GetIndex();
 
 		openList.push(pStartNode);
 		while (!openList.empty())
@@ -38,11 +40,10 @@ namespace Elite
 
 			for (auto con : m_pGraph->GetNodeConnections(currentNode->GetIndex()))
 			{
-				T_NodeType* nextNode = m_pGraph->GetNode(con->GetTo());
-				if (closedList.find(nextNode) == closedList.end())
+				if (parents[con->GetTo()] == invalid_node_index)
 				{
-					openList.push(nextNode);
-					closedList[nextNode] = currentNode;
+					openList.push(m_pGraph->GetNode(con->GetTo()));
+					parents[con->GetTo()] = currentNode->GetIndex();
 				}
 			}
 		}
@@ -50,11 +51,11 @@ namespace Elite
 		// track back
 
 		vector<T_NodeType*> path;
-		T_NodeType* currentNode = pDestinationNode;
-		while (currentNode != pStartNode && currentNode)
+		int currentIdx = pDestinationNode->GetIndex();
+		while (currentIdx != pStartNode->GetIndex() && currentIdx != invalid_node_index)
 		{
-			path.push_back(currentNode);
-			currentNode = closedList[currentNode];
+			path.push_back(m_pGraph->GetNode(currentIdx));
+			currentIdx = parents[currentIdx];
 		}
 
 		path.push_back(pStartNode);
@@ -0,0 +1,397 @@
+#pragma once
+#include "framework\EliteAI\EliteGraphs\EGridGraph.h"
+
+namespace Elite
+{
+	// Jump Point Search over the passability of a GridGraph whose passable cells all cost the same
+	// Straight and diagonal runs are scanned instead of expanded, only cells where an optimal path can turn (jump points) enter the open list
+	// With jump distances (JPS+) every cell knows how far it can jump in each direction, they are rebuilt on the first search after the cost field or the portal links changed
+	// Portal entries stop every run like the destination does, the cells behind their links are expanded in all directions like the start
+	// Grids with weighted cells or without diagonal connections can't be searched, see CanSearch
+	template <class T_NodeType, class T_ConnectionType>
+	class JumpPointSearch
+	{
+	public:
+		JumpPointSearch(GridGraph<T_NodeType, T_ConnectionType>* pGraph, bool useJumpDistances = false);
+
+		bool CanSearch();
+		// Every cell from start to destination like BFS::FindPath, empty when the destination can't be reached or the grid can't be searched
+		std::vector<T_NodeType*> FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode);
+
+		void SetUseJumpDistances(bool useJumpDistances) { m_UseJumpDistances = useJumpDistances; }
+		int GetNrOfExpandedNodes() const { return m_NrOfExpandedNodes; } // during the last FindPath
+
+	private:
+		struct SearchRecord
+		{
+			int cellIdx;
+			float costSoFar;
+			float estimatedTotalCost;
+		};
+
+		GridGraph<T_NodeType, T_ConnectionType>* m_pGraph;
+		bool m_UseJumpDistances;
+		int m_NrOfExpandedNodes = 0;
+
+		//refreshed when the cost field or portal links version changes
+		unsigned int m_CostFieldVersion = 0;
+		unsigned int m_PortalLinksVersion = 0;
+		bool m_ArePortalLinksChecked = false;
+		bool m_IsCostFieldChecked = false;
+		bool m_IsUniform = false;
+		float m_StraightCost = 0.f;
+		float m_DiagonalCost = 0.f;
+		//per cell and direction (EGridPolicies order): > 0 steps to the next jump point, <= 0 minus the free steps before a wall
+		std::vector<int> m_JumpDistances;
+		bool m_AreJumpDistancesValid = false;
+		//portal links can shortcut the octile estimate, the heuristic bounds a detour through them as well
+		std::vector<int> m_PortalEntryCells;
+		std::vector<int> m_PortalExitCells;
+		float m_MinPortalCost = 0.f;
+		float m_MinExitToDestinationCost = FLT_MAX;
+
+		//a cell's cost and parent only count when it carries the current stamp
+		std::vector<float> m_Costs;
+		std::vector<int> m_Parents;
+		std::vector<bool> m_IsReachedByPortal;
+		std::vector<unsigned int> m_Stamps;
+		unsigned int m_Stamp = 0;
+		std::vector<SearchRecord> m_OpenList;
+
+		bool IsFree(int col, int row) const;
+		bool HasForcedNeighbour(int col, int row, int dCol, int dRow) const;
+		float GetOctileCost(int dCol, int dRow) const;
+		float GetHeuristicCost(int col, int row, int destinationCol, int destinationRow) const;
+		// Next jump point from (col, row) in the direction, or the destination or a portal entry when the run passes it, invalid_node_index when the run hits a wall
+		int Jump(int col, int row, int dCol, int dRow, int destinationCol, int destinationRow) const;
+		int JumpWithDistances(int col, int row, int direction, int destinationCol, int destinationRow) const;
+		void BuildJumpDistances();
+	};
+
+	template <class T_NodeType, class T_ConnectionType>
+	JumpPointSearch<T_NodeType, T_ConnectionType>::JumpPointSearch(GridGraph<T_NodeType, T_ConnectionType>* pGraph, bool useJumpDistances)
+		: m_pGraph(pGraph)
+		, m_UseJumpDistances(useJumpDistances)
+	{
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	bool JumpPointSearch<T_NodeType, T_ConnectionType>::CanSearch()
+	{
+		if (!m_IsCostFieldChecked || m_CostFieldVersion != m_pGraph->GetCostFieldVersion())
+		{
+			m_IsCostFieldChecked = true;
+			m_CostFieldVersion = m_pGraph->GetCostFieldVersion();
+			m_AreJumpDistancesValid = false;
+
+			int uniformCost = -1;
+			const unsigned char* costField = m_pGraph->GetCostField();
+			for (int idx = 0; idx < m_pGraph->GetNrOfNodes() && uniformCost != -2; ++idx)
+			{
+				if (costField[idx] != impassable_cell_cost && costField[idx] != uniformCost)
+					uniformCost = uniformCost == -1 ? costField[idx] : -2;
+			}
+			m_IsUniform = uniformCost > 0;
+			m_StraightCost = m_pGraph->GetDefaultCostStraight() * uniformCost;
+			m_DiagonalCost = m_pGraph->GetDefaultCostDiagonal() * uniformCost;
+		}
+		if (!m_ArePortalLinksChecked || m_PortalLinksVersion != m_pGraph->GetPortalLinksVersion())
+		{
+			m_ArePortalLinksChecked = true;
+			m_PortalLinksVersion = m_pGraph->GetPortalLinksVersion();
+			m_AreJumpDistancesValid = false;
+
+			m_PortalEntryCells.clear();
+			m_PortalExitCells.clear();
+			m_MinPortalCost = FLT_MAX;
+			for (const auto& entry : m_pGraph->GetAllPortalLinks())
+			{
+				if (entry.second.empty())
+					continue;
+				m_PortalEntryCells.push_back(entry.first);
+				for (const PortalLink& link : entry.second)
+				{
+					m_PortalExitCells.push_back(link.CellIdx);
+					m_MinPortalCost = std::min(m_MinPortalCost, std::max(link.Cost, 0.f));
+				}
+			}
+		}
+		//pruning relies on the octile metric: a diagonal step costs at least a straight one and at most two
+		return m_IsUniform && m_pGraph->IsConnectedDiagonally()
+			&& m_StraightCost <= m_DiagonalCost && m_DiagonalCost <= 2.f * m_StraightCost;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	std::vector<T_NodeType*> JumpPointSearch<T_NodeType, T_ConnectionType>::FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode)
+	{
+		m_NrOfExpandedNodes = 0;
+		std::vector<T_NodeType*> path;
+		const int startIdx = pStartNode->GetIndex();
+		const int destinationIdx = pDestinationNode->GetIndex();
+		if (!CanSearch() || !m_pGraph->IsPassable(startIdx) || !m_pGraph->IsPassable(destinationIdx))
+			return path;
+		if (m_UseJumpDistances && !m_AreJumpDistancesValid)
+			BuildJumpDistances();
+
+		const int nrOfNodes = m_pGraph->GetNrOfNodes();
+		if (int(m_Stamps.size()) != nrOfNodes)
+		{
+			m_Costs.resize(nrOfNodes);
+			m_Parents.resize(nrOfNodes);
+			m_IsReachedByPortal.resize(nrOfNodes);
+			m_Stamps.assign(nrOfNodes, 0);
+			m_Stamp = 0;
+		}
+		if (++m_Stamp == 0)
+		{
+			std::fill(m_Stamps.begin(), m_Stamps.end(), 0);
+			m_Stamp = 1;
+		}
+
+		int destinationCol, destinationRow;
+		m_pGraph->GetColRow(destinationIdx, destinationCol, destinationRow);
+		m_MinExitToDestinationCost = FLT_MAX;
+		for (int exitIdx : m_PortalExitCells)
+		{
+			int exitCol, exitRow;
+			m_pGraph->GetColRow(exitIdx, exitCol, exitRow);
+			m_MinExitToDestinationCost = std::min(m_MinExitToDestinationCost, GetOctileCost(destinationCol - exitCol, destinationRow - exitRow));
+		}
+		//lowest estimate on top, ties go to the record furthest along
+		auto isWorse = [](const SearchRecord& a, const SearchRecord& b)
+		{
+			return a.estimatedTotalCost != b.estimatedTotalCost ? a.estimatedTotalCost > b.estimatedTotalCost : a.costSoFar < b.costSoFar;
+		};
+		auto openCell = [this, destinationCol, destinationRow, &isWorse](int idx, int parentIdx, float costSoFar, bool isReachedByPortal)
+		{
+			if (m_Stamps[idx] == m_Stamp && m_Costs[idx] <= costSoFar)
+				return;
+			m_Stamps[idx] = m_Stamp;
+			m_Costs[idx] = costSoFar;
+			m_Parents[idx] = parentIdx;
+			m_IsReachedByPortal[idx] = isReachedByPortal;
+			int col, row;
+			m_pGraph->GetColRow(idx, col, row);
+			m_OpenList.push_back({ idx, costSoFar, costSoFar + GetHeuristicCost(col, row, destinationCol, destinationRow) });
+			std::push_heap(m_OpenList.begin(), m_OpenList.end(), isWorse);
+		};
+
+		m_OpenList.clear();
+		openCell(startIdx, invalid_node_index, 0.f, false);
+		while (!m_OpenList.empty())
+		{
+			std::pop_heap(m_OpenList.begin(), m_OpenList.end(), isWorse);
+			const SearchRecord currentRecord = m_OpenList.back();
+			m_OpenList.pop_back();
+			const int currentIdx = currentRecord.cellIdx;
+			if (currentRecord.costSoFar > m_Costs[currentIdx])
+			{
+				continue; //outdated record, the cell was reopened with a lower cost
+			}
+			if (currentIdx == destinationIdx)
+			{
+				//jump points are joined by straight or diagonal runs, every cell of them is part of the path
+				for (int idx = destinationIdx; m_Parents[idx] != invalid_node_index; idx = m_Parents[idx])
+				{
+					if (m_IsReachedByPortal[idx])
+					{
+						path.push_back(m_pGraph->GetNode(idx));
+						continue;
+					}
+					int col, row, parentCol, parentRow;
+					m_pGraph->GetColRow(idx, col, row);
+					m_pGraph->GetColRow(m_Parents[idx], parentCol, parentRow);
+					const int dCol = parentCol > col ? 1 : (parentCol < col ? -1 : 0);
+					const int dRow = parentRow > row ? 1 : (parentRow < row ? -1 : 0);
+					for (; col != parentCol || row != parentRow; col += dCol, row += dRow)
+					{
+						path.push_back(m_pGraph->GetNode(col, row));
+					}
+				}
+				path.push_back(pStartNode);
+				std::reverse(path.begin(), path.end());
+				return path;
+			}
+			++m_NrOfExpandedNodes;
+
+			int col, row;
+			m_pGraph->GetColRow(currentIdx, col, row);
+			int dCol = 0, dRow = 0;
+			if (m_Parents[currentIdx] != invalid_node_index && !m_IsReachedByPortal[currentIdx])
+			{
+				int parentCol, parentRow;
+				m_pGraph->GetColRow(m_Parents[currentIdx], parentCol, parentRow);
+				dCol = col > parentCol ? 1 : (col < parentCol ? -1 : 0);
+				dRow = row > parentRow ? 1 : (row < parentRow ? -1 : 0);
+			}
+
+			//pruned neighbours: the natural ones of the direction the cell was reached in, plus the forced ones
+			for (int direction = 0; direction < NR_OF_GRID_DIRECTIONS; ++direction)
+			{
+				const int stepCol = GetGridDirectionCol(direction);
+				const int stepRow = GetGridDirectionRow(direction);
+				bool isNeeded = dCol == 0 && dRow == 0;
+				if (dCol != 0 && dRow != 0)
+				{
+					isNeeded = (stepCol == dCol && stepRow == dRow) || (stepCol == dCol && stepRow == 0) || (stepCol == 0 && stepRow == dRow)
+						|| (stepCol == -dCol && stepRow == dRow && !IsFree(col - dCol, row))
+						|| (stepCol == dCol && stepRow == -dRow && !IsFree(col, row - dRow));
+				}
+				else if (dCol != 0)
+				{
+					isNeeded = stepCol == dCol && (stepRow == 0 || !IsFree(col, row + stepRow));
+				}
+				else if (dRow != 0)
+				{
+					isNeeded = stepRow == dRow && (stepCol == 0 || !IsFree(col + stepCol, row));
+				}
+				if (!isNeeded)
+					continue;
+
+				const int jumpIdx = m_UseJumpDistances ? JumpWithDistances(col, row, direction, destinationCol, destinationRow)
+					: Jump(col, row, stepCol, stepRow, destinationCol, destinationRow);
+				if (jumpIdx == invalid_node_index)
+					continue;
+				int jumpCol, jumpRow;
+				m_pGraph->GetColRow(jumpIdx, jumpCol, jumpRow);
+				openCell(jumpIdx, currentIdx, currentRecord.costSoFar + GetOctileCost(jumpCol - col, jumpRow - row), false);
+			}
+			if (m_pGraph->HasPortalLinks(currentIdx))
+			{
+				for (const PortalLink& link : m_pGraph->GetPortalLinks(currentIdx))
+				{
+					if (m_pGraph->IsPassable(link.CellIdx))
+						openCell(link.CellIdx, currentIdx, currentRecord.costSoFar + link.Cost, true);
+				}
+			}
+		}
+		return path;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	bool JumpPointSearch<T_NodeType, T_ConnectionType>::IsFree(int col, int row) const
+	{
+		return m_pGraph->IsWithinBounds(col, row) && m_pGraph->IsPassable(m_pGraph->GetIndex(col, row));
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	bool JumpPointSearch<T_NodeType, T_ConnectionType>::HasForcedNeighbour(int col, int row, int dCol, int dRow) const
+	{
+		//diagonal steps may cut corners, so only a wall beside the run forces a turn
+		if (dCol != 0 && dRow != 0)
+			return (!IsFree(col - dCol, row) && IsFree(col - dCol, row + dRow)) || (!IsFree(col, row - dRow) && IsFree(col + dCol, row - dRow));
+		if (dCol != 0)
+			return (!IsFree(col, row + 1) && IsFree(col + dCol, row + 1)) || (!IsFree(col, row - 1) && IsFree(col + dCol, row - 1));
+		return (!IsFree(col + 1, row) && IsFree(col + 1, row + dRow)) || (!IsFree(col - 1, row) && IsFree(col - 1, row + dRow));
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	float JumpPointSearch<T_NodeType, T_ConnectionType>::GetOctileCost(int dCol, int dRow) const
+	{
+		const int straight = std::abs(std::abs(dCol) - std::abs(dRow));
+		const int diagonal = std::min(std::abs(dCol), std::abs(dRow));
+		return straight * m_StraightCost + diagonal * m_DiagonalCost;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	float JumpPointSearch<T_NodeType, T_ConnectionType>::GetHeuristicCost(int col, int row, int destinationCol, int destinationRow) const
+	{
+		const float directCost = GetOctileCost(destinationCol - col, destinationRow - row);
+		if (m_PortalEntryCells.empty())
+			return directCost;
+
+		//a path through portals walks to an entry, pays a link and walks from an exit, every part is bounded separately
+		float toEntryCost = FLT_MAX;
+		for (int entryIdx : m_PortalEntryCells)
+		{
+			int entryCol, entryRow;
+			m_pGraph->GetColRow(entryIdx, entryCol, entryRow);
+			toEntryCost = std::min(toEntryCost, GetOctileCost(entryCol - col, entryRow - row));
+		}
+		return std::min(directCost, toEntryCost + m_MinPortalCost + m_MinExitToDestinationCost);
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	int JumpPointSearch<T_NodeType, T_ConnectionType>::Jump(int col, int row, int dCol, int dRow, int destinationCol, int destinationRow) const
+	{
+		while (true)
+		{
+			col += dCol;
+			row += dRow;
+			if (!IsFree(col, row))
+				return invalid_node_index;
+			if ((col == destinationCol && row == destinationRow) || HasForcedNeighbour(col, row, dCol, dRow) || m_pGraph->HasPortalLinks(m_pGraph->GetIndex(col, row)))
+				return m_pGraph->GetIndex(col, row);
+			//a diagonal run stops where one of its straight runs finds something
+			if (dCol != 0 && dRow != 0
+				&& (Jump(col, row, dCol, 0, destinationCol, destinationRow) != invalid_node_index || Jump(col, row, 0, dRow, destinationCol, destinationRow) != invalid_node_index))
+				return m_pGraph->GetIndex(col, row);
+		}
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	int JumpPointSearch<T_NodeType, T_ConnectionType>::JumpWithDistances(int col, int row, int direction, int destinationCol, int destinationRow) const
+	{
+		const int dCol = GetGridDirectionCol(direction);
+		const int dRow = GetGridDirectionRow(direction);
+		const int distance = m_JumpDistances[m_pGraph->GetIndex(col, row) * NR_OF_GRID_DIRECTIONS + direction];
+		const int reach = distance > 0 ? distance : -distance;
+		const int toDestinationCol = (destinationCol - col) * dCol;
+		const int toDestinationRow = (destinationRow - row) * dRow;
+
+		//the tables don't know the destination: stop on it, or for diagonals where a straight run towards it starts
+		if (dCol == 0 || dRow == 0)
+		{
+			const int steps = dCol != 0 ? toDestinationCol : toDestinationRow;
+			const bool isOnRun = dCol != 0 ? destinationRow == row : destinationCol == col;
+			if (isOnRun && steps > 0 && steps <= reach)
+				return m_pGraph->GetIndex(destinationCol, destinationRow);
+		}
+		else if (toDestinationCol > 0 && toDestinationRow > 0)
+		{
+			const int steps = std::min(toDestinationCol, toDestinationRow);
+			if (steps <= reach)
+				return m_pGraph->GetIndex(col + steps * dCol, row + steps * dRow);
+		}
+		return distance > 0 ? m_pGraph->GetIndex(col + distance * dCol, row + distance * dRow) : invalid_node_index;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	void JumpPointSearch<T_NodeType, T_ConnectionType>::BuildJumpDistances()
+	{
+		const int nrOfColumns = m_pGraph->GetColumns();
+		const int nrOfRows = m_pGraph->GetRows();
+		m_JumpDistances.assign(m_pGraph->GetNrOfNodes() * NR_OF_GRID_DIRECTIONS, 0);
+
+		//every cell continues the value of the next cell in the direction, so cells are visited against it
+		//the straight directions come first, the diagonal ones read them
+		for (int direction = 0; direction < NR_OF_GRID_DIRECTIONS; ++direction)
+		{
+			const int dCol = GetGridDirectionCol(direction);
+			const int dRow = GetGridDirectionRow(direction);
+			for (int i = 0; i < nrOfRows; ++i)
+			{
+				const int row = dRow > 0 ? nrOfRows - 1 - i : i;
+				for (int j = 0; j < nrOfColumns; ++j)
+				{
+					const int col = dCol > 0 ? nrOfColumns - 1 - j : j;
+					const int nextCol = col + dCol;
+					const int nextRow = row + dRow;
+					if (!IsFree(col, row) || !IsFree(nextCol, nextRow))
+						continue;
+
+					const int nextIdx = m_pGraph->GetIndex(nextCol, nextRow);
+					bool isJumpPoint = HasForcedNeighbour(nextCol, nextRow, dCol, dRow) || m_pGraph->HasPortalLinks(nextIdx);
+					if (dCol != 0 && dRow != 0)
+					{
+						isJumpPoint |= m_JumpDistances[nextIdx * NR_OF_GRID_DIRECTIONS + (dCol > 0 ? 0 : 2)] > 0
+							|| m_JumpDistances[nextIdx * NR_OF_GRID_DIRECTIONS + (dRow > 0 ? 1 : 3)] > 0;
+					}
+					const int next = m_JumpDistances[nextIdx * NR_OF_GRID_DIRECTIONS + direction];
+					m_JumpDistances[m_pGraph->GetIndex(col, row) * NR_OF_GRID_DIRECTIONS + direction] = isJumpPoint ? 1 : (next > 0 ? next + 1 : next - 1);
+				}
+			}
+		}
+		m_AreJumpDistancesValid = true;
+	}
+}
@@ -1,7 +1,7 @@
 #include "stdafx.h"
 #include "EGraphEditor.h"
 
-bool Elite::EGraphEditor::UpdateGraph(GridGraph<GridTerrainNode, GraphConnection>* pGraph, std::vector<Obstacle*>* obstacles)
+bool Elite::EGraphEditor::UpdateGraph(GridGraph<GridTerrainNode, GraphConnection>* pGraph, ObstacleGrid* pObstacles)
 {
 #pragma region UI
 	//Extra Grid Terrain UI
@@ -23,6 +23,11 @@ bool Elite::EGraphEditor::UpdateGraph(GridGraph<GridTerrainNode, GraphConnection
 
 		}
 		
+		ImGui::Unindent();
+		ImGui::Text("Brush Radius");
+		ImGui::Indent();
+		ImGui::SliderInt("##BrushRadius", &m_BrushRadius, 0, 10);
+		ImGui::Unindent();
 		/*Spacing*/ImGui::Spacing(); ImGui::Separator(); ImGui::Spacing(); ImGui::Spacing();
 
 		//End
@@ -44,34 +49,39 @@ bool Elite::EGraphEditor::UpdateGraph(GridGraph<GridTerrainNode, GraphConnection
 		if (idx != invalid_node_index)
 		{
 			std::vector<TerrainType> terrainTypeVec{ TerrainType::Ground, TerrainType::Mud, TerrainType::Water };
-			if (pGraph->GetNode(idx)->GetTerrainType() == TerrainType::Water)
-			{
-				Vector2 nodeCenter{pGraph->GetNodeWorldPos(idx)};
-				auto obstacleIt = std::find_if(obstacles->begin(), obstacles->end(), [&nodeCenter](Obstacle* obstacle) {
-					return Elite::AreEqual(obstacle->GetCenter().x, nodeCenter.x) && Elite::AreEqual(obstacle->GetCenter().y, nodeCenter.y);
-					});
-				if (obstacleIt != obstacles->end())
-				{
-					delete (*obstacles)[obstacleIt - obstacles->begin()];
-					(*obstacles)[obstacleIt - obstacles->begin()] = obstacles->back();
-					obstacles->pop_back();
-				}
-			}
-			pGraph->GetNode(idx)->SetTerrainType(terrainTypeVec[m_SelectedTerrainType]);
-			
-			switch (terrainTypeVec[m_SelectedTerrainType])
-			{
-			case TerrainType::Water:
-				pGraph->IsolateNode(idx);
-				obstacles->push_back(new Obstacle{ pGraph->GetNodeWorldPos(idx), float(pGraph->GetCellSize())/2.f});
-				break;
-			default:
-				pGraph->UnIsolateNode(idx);
-				break;
-			}
-			return true;
+			GridEditTransaction<GridTerrainNode, GraphConnection> edit{ pGraph };
+			edit.Begin();
+			if (m_BrushRadius == 0)
+				edit.SetCell(idx, terrainTypeVec[m_SelectedTerrainType]);
+			else
+				edit.SetCircle(pGraph->GetNodeWorldPos(idx), float(m_BrushRadius * pGraph->GetCellSize()), terrainTypeVec[m_SelectedTerrainType]);
+
+			return CommitEdit(edit, pGraph, pObstacles);
 		}
 	}
 
 	return false;
 }
+
+bool Elite::EGraphEditor::CommitEdit(GridEditTransaction<GridTerrainNode, GraphConnection>& edit, GridGraph<GridTerrainNode, GraphConnection>* pGraph, ObstacleGrid* pObstacles)
+{
+	m_LastEdit = edit.Commit();
+
+	for (const GridCellChange& change : m_LastEdit.ChangedCells)
+	{
+		bool wasPassable = GetTerrainCellCost(change.PreviousTerrain) != impassable_cell_cost;
+		bool isPassable = GetTerrainCellCost(change.NewTerrain) != impassable_cell_cost;
+		if (wasPassable == isPassable)
+			continue;
+
+		//the obstacle grid is always row major, whatever the graph's layout
+		const Vector2 colRow = pGraph->GetNodePos(change.Index);
+		const int obstacleCellIdx = int(colRow.y) * pGraph->GetColumns() + int(colRow.x);
+		if (!wasPassable)
+			pObstacles->Remove(obstacleCellIdx);
+		else
+			pObstacles->Add(obstacleCellIdx, pGraph->GetNodeWorldPos(change.Index), float(pGraph->GetCellSize()) / 2.f);
+	}
+
+	return m_LastEdit.HasChanges();
+}
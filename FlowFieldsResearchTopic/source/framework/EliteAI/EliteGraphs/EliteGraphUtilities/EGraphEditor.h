@@ -2,7 +2,8 @@
 #include "framework\EliteAI\EliteGraphs\EGraphNodeTypes.h"
 #include "framework\EliteAI\EliteGraphs\EGraphConnectionTypes.h"
 #include "framework\EliteAI\EliteGraphs\EGridGraph.h"
-#include "projects\App_Flowfield\Obstacle.h"
+#include "framework\EliteAI\EliteGraphs\EliteGraphUtilities\EGridEditTransaction.h"
+#include "projects\App_Flowfield\ObstacleGrid.h"
 
 namespace Elite 
 {
@@ -12,9 +13,16 @@ namespace Elite
 		EGraphEditor() = default;
 		~EGraphEditor() = default;
 
-		bool UpdateGraph(GridGraph<GridTerrainNode, GraphConnection>* pGraph, std::vector<Obstacle*>* obstacles);
+		bool UpdateGraph(GridGraph<GridTerrainNode, GraphConnection>* pGraph, ObstacleGrid* pObstacles);
+
+		// Commits all edits of the transaction at once and keeps the obstacles in sync with the impassable cells
+		// Use this for scripted changes (explosions, buildings), the caller only has to recompute the flow field once when it returns true
+		bool CommitEdit(GridEditTransaction<GridTerrainNode, GraphConnection>& edit, GridGraph<GridTerrainNode, GraphConnection>* pGraph, ObstacleGrid* pObstacles);
+		const GridEditResult& GetLastEdit() const { return m_LastEdit; }
 	private:
 		int m_SelectedTerrainType = (int)TerrainType::Ground;
+		int m_BrushRadius = 0; // in cells
+		GridEditResult m_LastEdit;
 		
 	};
 }
@@ -15,7 +15,7 @@ namespace Elite
 
 
 		template<class T_NodeType, class T_ConnectionType>
-		void RenderGraph(GridGraph<T_NodeType, T_ConnectionType>* pGraph, bool renderNodes, bool renderNodeNumbers, bool renderConnections, bool renderConnectionsCosts, const std::vector<float>* cellCosts = nullptr, bool renderCellCosts = false, const std::vector<Vector2>* flowField = nullptr, bool renderFlowField = false) const;
+		void RenderGraph(GridGraph<T_NodeType, T_ConnectionType>* pGraph, bool renderNodes, bool renderNodeNumbers, bool renderConnections, bool renderConnectionsCosts, const float* cellCosts = nullptr, bool renderCellCosts = false, const std::vector<Vector2>* flowField = nullptr, bool renderFlowField = false) const;
 
 		template<class T_NodeType>
 		void RenderHighlighted(std::vector<T_NodeType*> path, Color col = HIGHLIGHTED_NODE_COLOR) const;
@@ -36,8 +36,9 @@ namespace Elite
 
 
 	template<class T_NodeType, class T_ConnectionType>
-	void EGraphRenderer::RenderGraph(GridGraph<T_NodeType, T_ConnectionType>* pGraph, bool renderNodes, bool renderNodeNumbers, bool renderConnections, bool renderConnectionsCosts, const std::vector<float>* cellCosts, bool renderCellCosts, const std::vector<Vector2>* flowField, bool renderFlowField) const
+	void EGraphRenderer::RenderGraph(GridGraph<T_NodeType, T_ConnectionType>* pGraph, bool renderNodes, bool renderNodeNumbers, bool renderConnections, bool renderConnectionsCosts, const float* cellCosts, bool renderCellCosts, const std::vector<Vector2>* flowField, bool renderFlowField) const
 	{
+		ELITE_PROFILE_SCOPE("RenderGraph");
 		if (renderNodes)
 		{
 			//Nodes/Grid
@@ -45,7 +46,7 @@ namespace Elite
 			{
 				for (auto c = 0; c < pGraph->m_NrOfColumns; ++c)
 				{
-					int idx = r * pGraph->m_NrOfColumns + c;
+					int idx = pGraph->GetIndex(c, r);
 					Vector2 cellPos{ pGraph->GetNodeWorldPos(idx) };
 
 					int cellSize = pGraph->m_CellSize;
@@ -70,7 +71,7 @@ namespace Elite
 					std::string text{};
 					if (renderCellCosts)
 					{
-						text = to_string((*cellCosts)[idx]);
+						text = to_string(cellCosts[idx]);
 					}
 					
 					if (renderNodeNumbers)
@@ -82,7 +83,32 @@ namespace Elite
 			}
 		}
 
-		if (renderConnections)
+		if (renderConnections && !pGraph->HasConnections())
+		{
+			//Implicit connections from the cost field, these grids create their nodes on use so the cells are visited by index
+			for (int idx = 0; idx < pGraph->GetNrOfNodes(); ++idx)
+			{
+				if (!pGraph->IsPassable(idx))
+					continue;
+
+				pGraph->ForEachNeighbour(idx, [this, pGraph, idx, renderConnectionsCosts](int neighbourIdx, float stepCost)
+					{
+						std::string text{ };
+						if (renderConnectionsCosts)
+						{
+							std::stringstream ss;
+							ss << std::fixed << std::setprecision(1) << stepCost;
+							text = ss.str();
+						}
+						RenderConnection(nullptr,
+							pGraph->GetNodeWorldPos(neighbourIdx),
+							pGraph->GetNodeWorldPos(idx),
+							text
+						);
+					});
+			}
+		}
+		else if (renderConnections)
 		{
 			for (auto node : pGraph->GetAllNodes())
 			{
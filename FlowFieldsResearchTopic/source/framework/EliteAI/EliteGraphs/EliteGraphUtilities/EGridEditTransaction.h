@@ -0,0 +1,204 @@
+#pragma once
+#include "framework\EliteAI\EliteGraphs\EGraphNodeTypes.h"
+#include "framework\EliteAI\EliteGraphs\EGraphConnectionTypes.h"
+#include "framework\EliteAI\EliteGraphs\EGridGraph.h"
+
+namespace Elite
+{
+	// Inclusive range of grid cells
+	struct GridRect
+	{
+		int MinCol = 0;
+		int MinRow = 0;
+		int MaxCol = -1;
+		int MaxRow = -1;
+
+		bool IsEmpty() const { return MaxCol < MinCol || MaxRow < MinRow; }
+		bool Contains(int col, int row) const { return col >= MinCol && col <= MaxCol && row >= MinRow && row <= MaxRow; }
+		bool Touches(const GridRect& other) const
+		{
+			return MinCol <= other.MaxCol + 1 && other.MinCol <= MaxCol + 1
+				&& MinRow <= other.MaxRow + 1 && other.MinRow <= MaxRow + 1;
+		}
+		void Merge(const GridRect& other)
+		{
+			MinCol = std::min(MinCol, other.MinCol);
+			MinRow = std::min(MinRow, other.MinRow);
+			MaxCol = std::max(MaxCol, other.MaxCol);
+			MaxRow = std::max(MaxRow, other.MaxRow);
+		}
+	};
+
+	struct GridCellChange
+	{
+		int Index = invalid_node_index;
+		TerrainType PreviousTerrain = TerrainType::Ground;
+		TerrainType NewTerrain = TerrainType::Ground;
+	};
+
+	struct GridEditResult
+	{
+		std::vector<GridCellChange> ChangedCells; // only cells whose terrain actually changed, sorted by index
+		std::vector<GridRect> DirtyRects; // disjoint, non touching rectangles covering all changed cells
+
+		bool HasChanges() const { return !ChangedCells.empty(); }
+	};
+
+	// Collects terrain edits and applies them to the grid in one go on Commit
+	// Usage: Begin(), any amount of SetCell/SetRect/SetCircle, Commit()
+	template<class T_NodeType, class T_ConnectionType>
+	class GridEditTransaction final
+	{
+	public:
+		explicit GridEditTransaction(GridGraph<T_NodeType, T_ConnectionType>* pGraph) : m_pGraph(pGraph) {}
+		~GridEditTransaction() = default;
+
+		void Begin();
+		bool IsOpen() const { return m_IsOpen; }
+
+		// Later edits of the same cell overwrite earlier ones
+		void SetCell(int idx, TerrainType terrain);
+		void SetRect(int minCol, int minRow, int maxCol, int maxRow, TerrainType terrain);
+		void SetCircle(const Vector2& worldCenter, float worldRadius, TerrainType terrain);
+
+		// Writes all pending edits to the grid, batched per terrain type
+		const GridEditResult& Commit();
+		const GridEditResult& GetLastResult() const { return m_Result; }
+
+	private:
+		GridGraph<T_NodeType, T_ConnectionType>* m_pGraph;
+		std::unordered_map<int, TerrainType> m_PendingCells;
+		GridEditResult m_Result;
+		bool m_IsOpen = false;
+
+		void AddDirtyRect(std::vector<GridRect>& rects, GridRect rect) const;
+
+		//C++ make the class non-copyable
+		GridEditTransaction(const GridEditTransaction&) = delete;
+		GridEditTransaction& operator=(const GridEditTransaction&) = delete;
+	};
+
+	template<class T_NodeType, class T_ConnectionType>
+	void GridEditTransaction<T_NodeType, T_ConnectionType>::Begin()
+	{
+		m_PendingCells.clear();
+		m_IsOpen = true;
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	void GridEditTransaction<T_NodeType, T_ConnectionType>::SetCell(int idx, TerrainType terrain)
+	{
+		assert(m_IsOpen && "<GridEditTransaction::SetCell>: Begin has not been called");
+		if (idx < 0 || idx >= m_pGraph->GetNrOfNodes())
+			return;
+
+		m_PendingCells[idx] = terrain;
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	void GridEditTransaction<T_NodeType, T_ConnectionType>::SetRect(int minCol, int minRow, int maxCol, int maxRow, TerrainType terrain)
+	{
+		assert(m_IsOpen && "<GridEditTransaction::SetRect>: Begin has not been called");
+		minCol = std::max(minCol, 0);
+		minRow = std::max(minRow, 0);
+		maxCol = std::min(maxCol, m_pGraph->GetColumns() - 1);
+		maxRow = std::min(maxRow, m_pGraph->GetRows() - 1);
+
+		for (int r = minRow; r <= maxRow; ++r)
+		{
+			for (int c = minCol; c <= maxCol; ++c)
+			{
+				SetCell(m_pGraph->GetIndex(c, r), terrain);
+			}
+		}
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	void GridEditTransaction<T_NodeType, T_ConnectionType>::SetCircle(const Vector2& worldCenter, float worldRadius, TerrainType terrain)
+	{
+		assert(m_IsOpen && "<GridEditTransaction::SetCircle>: Begin has not been called");
+		const float cellSize = float(m_pGraph->GetCellSize());
+		const int minCol = int(floorf((worldCenter.x - worldRadius) / cellSize));
+		const int minRow = int(floorf((worldCenter.y - worldRadius) / cellSize));
+		const int maxCol = int(floorf((worldCenter.x + worldRadius) / cellSize));
+		const int maxRow = int(floorf((worldCenter.y + worldRadius) / cellSize));
+
+		//cells are part of the circle when their center is
+		const float radiusSquared = worldRadius * worldRadius;
+		for (int r = std::max(minRow, 0); r <= std::min(maxRow, m_pGraph->GetRows() - 1); ++r)
+		{
+			for (int c = std::max(minCol, 0); c <= std::min(maxCol, m_pGraph->GetColumns() - 1); ++c)
+			{
+				if (DistanceSquared(m_pGraph->GetNodeWorldPos(c, r), worldCenter) <= radiusSquared)
+					SetCell(m_pGraph->GetIndex(c, r), terrain);
+			}
+		}
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	const GridEditResult& GridEditTransaction<T_NodeType, T_ConnectionType>::Commit()
+	{
+		assert(m_IsOpen && "<GridEditTransaction::Commit>: Begin has not been called");
+		m_IsOpen = false;
+
+		m_Result.ChangedCells.clear();
+		m_Result.DirtyRects.clear();
+
+		//Filter out cells that already have the requested terrain
+		for (const auto& pending : m_PendingCells)
+		{
+			TerrainType previousTerrain = m_pGraph->GetCellTerrain(pending.first);
+			if (previousTerrain != pending.second)
+				m_Result.ChangedCells.push_back(GridCellChange{ pending.first, previousTerrain, pending.second });
+		}
+		m_PendingCells.clear();
+
+		std::sort(m_Result.ChangedCells.begin(), m_Result.ChangedCells.end(), [](const GridCellChange& lh, const GridCellChange& rh) {
+			return lh.Index < rh.Index;
+			});
+
+		//One batched write per terrain type
+		std::unordered_map<int, std::vector<int>> cellsPerTerrain;
+		for (const GridCellChange& change : m_Result.ChangedCells)
+		{
+			cellsPerTerrain[int(change.NewTerrain)].push_back(change.Index);
+
+			Vector2 colRow = m_pGraph->GetNodePos(change.Index);
+			AddDirtyRect(m_Result.DirtyRects, GridRect{ int(colRow.x), int(colRow.y), int(colRow.x), int(colRow.y) });
+		}
+		for (const auto& cells : cellsPerTerrain)
+		{
+			m_pGraph->SetTerrainTypes(cells.second, TerrainType(cells.first));
+		}
+
+		return m_Result;
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	void GridEditTransaction<T_NodeType, T_ConnectionType>::AddDirtyRect(std::vector<GridRect>& rects, GridRect rect) const
+	{
+		//Grow the new rect with every rect it touches until it is disjoint from all others
+		//A merge moves the last rect into the freed slot, the pass continues there
+		//Rects passed before a merge can touch the grown rect, so passes repeat until one merges nothing
+		bool hasGrown = true;
+		while (hasGrown)
+		{
+			hasGrown = false;
+			for (size_t i = 0; i < rects.size();)
+			{
+				if (rects[i].Touches(rect))
+				{
+					rect.Merge(rects[i]);
+					rects[i] = rects.back();
+					rects.pop_back();
+					hasGrown = true;
+				}
+				else
+				{
+					++i;
+				}
+			}
+		}
+		rects.push_back(rect);
+	}
+}
@@ -0,0 +1,204 @@
+#include "stdafx.h"
+#include "EGridMapFile.h"
+
+using namespace Elite;
+
+namespace
+{
+	//File layout: header, terrain per cost value, portals, spawn points, cost raster.
+	//Every section starts aligned so it can be used in place, the raster last so it gets the most of the pages to itself.
+	//Values are stored in native (little endian) byte order.
+	const char MAP_MAGIC[4] = { 'E', 'G', 'M', 'P' };
+	const unsigned int MAP_VERSION = 1;
+	const unsigned long long MAP_SECTION_ALIGNMENT = 64;
+	const int NR_OF_COST_VALUES = 256;
+
+	unsigned long long AlignSection(unsigned long long offset)
+	{
+		return (offset + MAP_SECTION_ALIGNMENT - 1) & ~(MAP_SECTION_ALIGNMENT - 1);
+	}
+
+	bool IsTerrainType(TerrainType terrain)
+	{
+		return terrain == TerrainType::Ground || terrain == TerrainType::Mud || terrain == TerrainType::Water;
+	}
+
+	void WritePadding(std::ofstream& file, unsigned long long offset)
+	{
+		while (static_cast<unsigned long long>(file.tellp()) < offset)
+			file.put(0);
+	}
+}
+
+struct EGridMapFile::Header
+{
+	char Magic[4];
+	unsigned int Version;
+	int Columns;
+	int Rows;
+	int CellSize;
+	unsigned char Layout;
+	unsigned char IsConnectedDiagonally;
+	unsigned char Padding[2];
+	int NrOfPortals;
+	int NrOfSpawnPoints;
+	//from the start of the file
+	unsigned long long TerrainOffset;
+	unsigned long long PortalsOffset;
+	unsigned long long SpawnPointsOffset;
+	unsigned long long CostFieldOffset;
+	unsigned long long FileSize;
+};
+static_assert(sizeof(TerrainType) == sizeof(int) && sizeof(Vector2) == 2 * sizeof(float), "map sections are used in place");
+
+bool EGridMapFile::Open(const std::string& filePath)
+{
+	Close();
+	if (!m_File.Open(filePath))
+		return false;
+	//the header is read before anything else, a shorter file can't hold one
+	if (m_File.GetSize() < sizeof(Header))
+	{
+		Close();
+		return false;
+	}
+
+	//everything the file claims has to fit inside it, the sections are used without copying
+	const Header* pHeader = reinterpret_cast<const Header*>(m_File.GetData());
+	const unsigned long long nrOfCells = pHeader->Columns > 0 && pHeader->Rows > 0 ? static_cast<unsigned long long>(pHeader->Columns) * pHeader->Rows : 0;
+	auto isInFile = [this](unsigned long long offset, unsigned long long size)
+	{
+		return offset % MAP_SECTION_ALIGNMENT == 0 && m_File.Contains(offset, size);
+	};
+	if (!std::equal(MAP_MAGIC, MAP_MAGIC + 4, pHeader->Magic)
+		|| pHeader->Version != MAP_VERSION || pHeader->FileSize != m_File.GetSize()
+		|| nrOfCells == 0 || nrOfCells > static_cast<unsigned long long>((std::numeric_limits<int>::max)()) || pHeader->CellSize <= 0 || pHeader->NrOfPortals < 0 || pHeader->NrOfSpawnPoints < 0
+		|| pHeader->Layout > static_cast<unsigned char>(GridLayout::Tiled)
+		|| !isInFile(pHeader->TerrainOffset, NR_OF_COST_VALUES * sizeof(TerrainType))
+		|| !isInFile(pHeader->PortalsOffset, pHeader->NrOfPortals * sizeof(GridMapPortal))
+		|| !isInFile(pHeader->SpawnPointsOffset, pHeader->NrOfSpawnPoints * sizeof(Vector2))
+		|| !isInFile(pHeader->CostFieldOffset, nrOfCells))
+	{
+		Close();
+		return false;
+	}
+
+	unsigned char* pBytes = m_File.GetData();
+	m_pHeader = pHeader;
+	m_pTerrainOfCost = reinterpret_cast<const TerrainType*>(pBytes + pHeader->TerrainOffset);
+	m_pPortals = reinterpret_cast<const GridMapPortal*>(pBytes + pHeader->PortalsOffset);
+	m_pSpawnPoints = reinterpret_cast<const Vector2*>(pBytes + pHeader->SpawnPointsOffset);
+	m_pCostField = pBytes + pHeader->CostFieldOffset;
+
+	//cells index as int and the terrain table converts straight to TerrainType
+	for (int cost = 0; cost < NR_OF_COST_VALUES; ++cost)
+	{
+		if (!IsTerrainType(m_pTerrainOfCost[cost]))
+		{
+			Close();
+			return false;
+		}
+	}
+	for (int i = 0; i < pHeader->NrOfPortals; ++i)
+	{
+		if (unsigned(m_pPortals[i].FromIdx) >= nrOfCells || unsigned(m_pPortals[i].ToIdx) >= nrOfCells)
+		{
+			Close();
+			return false;
+		}
+	}
+	return true;
+}
+
+void EGridMapFile::Close()
+{
+	m_File.Close();
+	m_pHeader = nullptr;
+	m_pCostField = nullptr;
+	m_pTerrainOfCost = nullptr;
+	m_pPortals = nullptr;
+	m_pSpawnPoints = nullptr;
+}
+
+int EGridMapFile::GetColumns() const { return m_pHeader->Columns; }
+int EGridMapFile::GetRows() const { return m_pHeader->Rows; }
+int EGridMapFile::GetCellSize() const { return m_pHeader->CellSize; }
+GridLayout EGridMapFile::GetLayout() const { return static_cast<GridLayout>(m_pHeader->Layout); }
+bool EGridMapFile::IsConnectedDiagonally() const { return m_pHeader->IsConnectedDiagonally != 0; }
+int EGridMapFile::GetNrOfPortals() const { return m_pHeader->NrOfPortals; }
+int EGridMapFile::GetNrOfSpawnPoints() const { return m_pHeader->NrOfSpawnPoints; }
+
+GridGraph<GridTerrainNode, GraphConnection>* EGridMapFile::CreateGraph(bool isDirectionalGraph, float costStraight, float costDiagonal, bool createConnections) const
+{
+	assert(IsOpen() && "<EGridMapFile::CreateGraph>: no map open");
+	//without connections the graph creates its nodes on use, only the speed and portal flags are filled per cell here
+	auto pGraph = new GridGraph<GridTerrainNode, GraphConnection>(GetColumns(), GetRows(), GetCellSize(), isDirectionalGraph, IsConnectedDiagonally(),
+		costStraight, costDiagonal, createConnections, GetLayout(), m_pCostField, m_pTerrainOfCost);
+	for (int i = 0; i < GetNrOfPortals(); ++i)
+	{
+		pGraph->AddPortalLink(m_pPortals[i].FromIdx, m_pPortals[i].ToIdx, m_pPortals[i].Cost);
+	}
+	return pGraph;
+}
+
+bool EGridMapFile::Save(const std::string& filePath, const GridGraph<GridTerrainNode, GraphConnection>& graph, const std::vector<Vector2>& spawnPoints)
+{
+	//cost values no cell uses keep the terrain they would come from
+	TerrainType terrainOfCost[NR_OF_COST_VALUES];
+	bool isCostUsed[NR_OF_COST_VALUES]{};
+	for (int cost = 0; cost < NR_OF_COST_VALUES; ++cost)
+		terrainOfCost[cost] = cost == impassable_cell_cost ? TerrainType::Water : TerrainType::Ground;
+	const int nrOfCells = graph.GetNrOfNodes();
+	for (int idx = 0; idx < nrOfCells; ++idx)
+	{
+		const unsigned char cost = graph.GetCellCost(idx);
+		const TerrainType terrain = graph.GetCellTerrain(idx);
+		if (isCostUsed[cost] && terrainOfCost[cost] != terrain)
+			return false;
+		isCostUsed[cost] = true;
+		terrainOfCost[cost] = terrain;
+	}
+
+	std::vector<GridMapPortal> portals;
+	for (const auto& cellLinks : graph.GetAllPortalLinks())
+	{
+		for (const PortalLink& link : cellLinks.second)
+			portals.push_back({ cellLinks.first, link.CellIdx, link.Cost });
+	}
+	//the link table is unordered, sorting keeps saves of the same map identical
+	std::sort(portals.begin(), portals.end(), [](const GridMapPortal& a, const GridMapPortal& b)
+		{
+			return a.FromIdx != b.FromIdx ? a.FromIdx < b.FromIdx : a.ToIdx < b.ToIdx;
+		});
+
+	Header header{};
+	std::copy(MAP_MAGIC, MAP_MAGIC + 4, header.Magic);
+	header.Version = MAP_VERSION;
+	header.Columns = graph.GetColumns();
+	header.Rows = graph.GetRows();
+	header.CellSize = graph.GetCellSize();
+	header.Layout = static_cast<unsigned char>(graph.GetLayout());
+	header.IsConnectedDiagonally = graph.IsConnectedDiagonally() ? 1 : 0;
+	header.NrOfPortals = int(portals.size());
+	header.NrOfSpawnPoints = int(spawnPoints.size());
+	header.TerrainOffset = AlignSection(sizeof(Header));
+	header.PortalsOffset = AlignSection(header.TerrainOffset + sizeof(terrainOfCost));
+	header.SpawnPointsOffset = AlignSection(header.PortalsOffset + portals.size() * sizeof(GridMapPortal));
+	header.CostFieldOffset = AlignSection(header.SpawnPointsOffset + spawnPoints.size() * sizeof(Vector2));
+	header.FileSize = header.CostFieldOffset + nrOfCells;
+
+	std::ofstream file{ filePath, std::ios::binary };
+	if (!file.is_open())
+		return false;
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+	WritePadding(file, header.TerrainOffset);
+	file.write(reinterpret_cast<const char*>(terrainOfCost), sizeof(terrainOfCost));
+	WritePadding(file, header.PortalsOffset);
+	file.write(reinterpret_cast<const char*>(portals.data()), portals.size() * sizeof(GridMapPortal));
+	WritePadding(file, header.SpawnPointsOffset);
+	file.write(reinterpret_cast<const char*>(spawnPoints.data()), spawnPoints.size() * sizeof(Vector2));
+	WritePadding(file, header.CostFieldOffset);
+	file.write(reinterpret_cast<const char*>(graph.GetCostField()), nrOfCells);
+	return file.good();
+}
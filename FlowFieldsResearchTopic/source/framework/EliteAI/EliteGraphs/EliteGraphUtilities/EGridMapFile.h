@@ -0,0 +1,66 @@
+#pragma once
+#include "framework\EliteAI\EliteGraphs\EGraphNodeTypes.h"
+#include "framework\EliteAI\EliteGraphs\EGraphConnectionTypes.h"
+#include "framework\EliteAI\EliteGraphs\EGridGraph.h"
+
+namespace Elite
+{
+	// Portal link as stored in a map file
+	struct GridMapPortal
+	{
+		int FromIdx;
+		int ToIdx;
+		float Cost;
+	};
+
+	// Versioned binary grid map (cost raster, terrain per cost value, portal links, spawn points), memory mapped when opened
+	// The cost raster is mapped copy-on-write, so a graph can use it as its cost field directly: edits stay in memory and never reach the file
+	// Cells are stored in the index order of the grid's layout, a map always opens with the layout it was saved with
+	class EGridMapFile final
+	{
+	public:
+		EGridMapFile() = default;
+		~EGridMapFile() { Close(); }
+
+		// Fails on files that aren't maps, have another version or are truncated
+		bool Open(const std::string& filePath);
+		void Close();
+		bool IsOpen() const { return m_File.IsOpen(); }
+
+		int GetColumns() const;
+		int GetRows() const;
+		int GetCellSize() const;
+		GridLayout GetLayout() const;
+		bool IsConnectedDiagonally() const;
+
+		// Writable, see the copy-on-write note above
+		unsigned char* GetCostField() const { return m_pCostField; }
+		// 256 entries, the terrain of every cost value
+		const TerrainType* GetTerrainOfCost() const { return m_pTerrainOfCost; }
+		const GridMapPortal* GetPortals() const { return m_pPortals; }
+		int GetNrOfPortals() const;
+		const Vector2* GetSpawnPoints() const { return m_pSpawnPoints; }
+		int GetNrOfSpawnPoints() const;
+
+		// Creates a graph on top of the mapped cost field, only valid while the file stays open
+		GridGraph<GridTerrainNode, GraphConnection>* CreateGraph(bool isDirectionalGraph, float costStraight = 1.f, float costDiagonal = 1.5f, bool createConnections = false) const;
+
+		// Fails when two terrains share a cost value, the raster could not tell them apart
+		// The graph can't use the cost field of a file it overwrites, call GridGraph::UseOwnedCostField and Close first
+		static bool Save(const std::string& filePath, const GridGraph<GridTerrainNode, GraphConnection>& graph, const std::vector<Vector2>& spawnPoints);
+
+	private:
+		struct Header;
+
+		EMappedFile m_File;
+		const Header* m_pHeader = nullptr;
+		unsigned char* m_pCostField = nullptr;
+		const TerrainType* m_pTerrainOfCost = nullptr;
+		const GridMapPortal* m_pPortals = nullptr;
+		const Vector2* m_pSpawnPoints = nullptr;
+
+		//C++ make the class non-copyable
+		EGridMapFile(const EGridMapFile&) = delete;
+		EGridMapFile& operator=(const EGridMapFile&) = delete;
+	};
+}
@@ -44,5 +44,25 @@ namespace Elite
 			return std::max(x, y);
 		}
 	};
+
+	//Heuristic policies of the search templates: a function chosen at runtime, or one fixed at compile time so the call inlines
+	class RuntimeHeuristic
+	{
+	public:
+		RuntimeHeuristic(float(*pFunction)(float, float) = HeuristicFunctions::Manhattan) : m_pFunction(pFunction) {}
+		float operator()(float x, float y) const { return m_pFunction(x, y); }
+	private:
+		float(*m_pFunction)(float, float);
+	};
+
+	template<float(*T_Function)(float, float)>
+	struct StaticHeuristic
+	{
+		float operator()(float x, float y) const { return T_Function(x, y); }
+	};
+	typedef StaticHeuristic<HeuristicFunctions::Manhattan> ManhattanHeuristic;
+	typedef StaticHeuristic<HeuristicFunctions::Euclidean> EuclideanHeuristic;
+	typedef StaticHeuristic<HeuristicFunctions::Octile> OctileHeuristic;
+	typedef StaticHeuristic<HeuristicFunctions::Chebyshev> ChebyshevHeuristic;
 }
 #endif
\ No newline at end of file
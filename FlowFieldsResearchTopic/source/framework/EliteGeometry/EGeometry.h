@@ -11,4 +11,5 @@
 #include "EGeometry2DUtilities.h"
 /* --- TYPES --- */
 #include "EGeometry2DTypes.h"
+#include "EPolygonTriangulator.h"
 #endif
\ No newline at end of file
@@ -0,0 +1,711 @@
+//Precompiled Header [ALWAYS ON TOP IN CPP]
+#include "stdafx.h"
+#include "EPolygonTriangulator.h"
+
+using namespace Elite;
+
+namespace
+{
+	//Below this many vertices testing every vertex is cheaper than sorting them in z-order
+	const size_t Z_ORDER_MIN_VERTICES = 80;
+}
+
+#pragma region Triangulation
+void PolygonTriangulator::Triangulate(const std::vector<Vector2>& outerShape, const std::vector<std::vector<Vector2>>& holes, std::vector<Vector2>& vertices, std::vector<int>& indices)
+{
+	vertices.assign(outerShape.begin(), outerShape.end());
+	m_HoleStarts.clear();
+	for (const std::vector<Vector2>& hole : holes)
+	{
+		m_HoleStarts.push_back(int(vertices.size()));
+		vertices.insert(vertices.end(), hole.begin(), hole.end());
+	}
+	TriangulateVertices(vertices, indices);
+}
+
+void PolygonTriangulator::Triangulate(const Polygon& polygon, std::vector<Vector2>& vertices, std::vector<int>& indices)
+{
+	vertices.assign(polygon.GetPoints().begin(), polygon.GetPoints().end());
+	m_HoleStarts.clear();
+	for (const Polygon& child : polygon.GetChildren())
+	{
+		m_HoleStarts.push_back(int(vertices.size()));
+		vertices.insert(vertices.end(), child.GetPoints().begin(), child.GetPoints().end());
+	}
+	TriangulateVertices(vertices, indices);
+}
+
+void PolygonTriangulator::TriangulateVertices(const std::vector<Vector2>& vertices, std::vector<int>& indices)
+{
+	indices.clear();
+	m_Nodes.clear();
+	//every vertex, plus two per hole bridge
+	m_Nodes.reserve(vertices.size() + 2 * m_HoleStarts.size());
+
+	const int outerEnd = m_HoleStarts.empty() ? int(vertices.size()) : m_HoleStarts.front();
+	int outerNode = LinkShape(vertices, 0, outerEnd, true);
+	if (outerNode == -1 || m_Nodes[outerNode].Next == m_Nodes[outerNode].Prev)
+		return;
+
+	//holes lie inside the outer shape, its bounds cover everything
+	float maxX = vertices[0].x, maxY = vertices[0].y;
+	m_MinX = maxX;
+	m_MinY = maxY;
+	for (int i = 1; i < outerEnd; ++i)
+	{
+		m_MinX = std::min(m_MinX, vertices[i].x);
+		m_MinY = std::min(m_MinY, vertices[i].y);
+		maxX = std::max(maxX, vertices[i].x);
+		maxY = std::max(maxY, vertices[i].y);
+	}
+	const float size = std::max(maxX - m_MinX, maxY - m_MinY);
+	if (!m_HoleStarts.empty())
+		outerNode = EliminateHoles(vertices, outerNode, size);
+
+	//z-order codes are 16 bits per axis
+	m_InvSize = vertices.size() > Z_ORDER_MIN_VERTICES && size != 0.f ? 32767.f / size : 0.f;
+	indices.reserve(3 * (vertices.size() + 2 * m_HoleStarts.size() - 2));
+	EarcutLinked(outerNode, indices, 0);
+}
+
+int PolygonTriangulator::LinkShape(const std::vector<Vector2>& vertices, int start, int end, bool isOuter)
+{
+	if (end - start < 3)
+		return -1;
+
+	//the outer shape is linked counter clockwise, holes clockwise
+	float signedArea = 0.f;
+	for (int i = start, j = end - 1; i < end; j = i++)
+	{
+		signedArea += (vertices[j].x - vertices[i].x) * (vertices[i].y + vertices[j].y);
+	}
+	int last = -1;
+	if (isOuter == (signedArea > 0.f))
+	{
+		for (int i = start; i < end; ++i)
+			last = InsertNode(i, vertices[i], last);
+	}
+	else
+	{
+		for (int i = end - 1; i >= start; --i)
+			last = InsertNode(i, vertices[i], last);
+	}
+
+	if (last != -1 && IsEqual(last, m_Nodes[last].Next))
+	{
+		const int next = m_Nodes[last].Next;
+		RemoveNode(last);
+		last = next;
+	}
+	return last;
+}
+
+int PolygonTriangulator::InsertNode(int vertexIdx, const Vector2& position, int last)
+{
+	const int node = int(m_Nodes.size());
+	m_Nodes.push_back({ vertexIdx, position.x, position.y, node, node, 0, -1, -1 });
+	if (last != -1)
+	{
+		Node& inserted = m_Nodes[node];
+		inserted.Next = m_Nodes[last].Next;
+		inserted.Prev = last;
+		m_Nodes[m_Nodes[last].Next].Prev = node;
+		m_Nodes[last].Next = node;
+	}
+	return node;
+}
+
+void PolygonTriangulator::RemoveNode(int node)
+{
+	const Node& removed = m_Nodes[node];
+	m_Nodes[removed.Next].Prev = removed.Prev;
+	m_Nodes[removed.Prev].Next = removed.Next;
+	if (removed.PrevZ != -1)
+		m_Nodes[removed.PrevZ].NextZ = removed.NextZ;
+	if (removed.NextZ != -1)
+		m_Nodes[removed.NextZ].PrevZ = removed.PrevZ;
+	if (m_IsIndexingEdges)
+		IndexEdge(removed.Prev);
+}
+
+int PolygonTriangulator::FilterPoints(int start, int end)
+{
+	//removes duplicate and collinear points
+	if (start == -1)
+		return start;
+	if (end == -1)
+		end = start;
+
+	int p = start;
+	bool again;
+	do
+	{
+		again = false;
+		if (IsEqual(p, m_Nodes[p].Next) || Area(m_Nodes[p].Prev, p, m_Nodes[p].Next) == 0.f)
+		{
+			RemoveNode(p);
+			p = end = m_Nodes[p].Prev;
+			if (p == m_Nodes[p].Next)
+				break;
+			again = true;
+		}
+		else
+		{
+			p = m_Nodes[p].Next;
+		}
+	} while (again || p != end);
+	return end;
+}
+
+void PolygonTriangulator::EarcutLinked(int ear, std::vector<int>& indices, int pass)
+{
+	if (ear == -1)
+		return;
+	if (pass == 0 && m_InvSize != 0.f)
+		IndexCurve(ear);
+
+	int stop = ear;
+	while (m_Nodes[ear].Prev != m_Nodes[ear].Next)
+	{
+		const int prev = m_Nodes[ear].Prev;
+		const int next = m_Nodes[ear].Next;
+		if (m_InvSize != 0.f ? IsEarHashed(ear) : IsEar(ear))
+		{
+			indices.push_back(m_Nodes[prev].VertexIdx);
+			indices.push_back(m_Nodes[ear].VertexIdx);
+			indices.push_back(m_Nodes[next].VertexIdx);
+			RemoveNode(ear);
+
+			//skipping the next vertex leaves fewer sliver triangles
+			ear = stop = m_Nodes[next].Next;
+			continue;
+		}
+
+		ear = next;
+		if (ear == stop)
+		{
+			//no ears left: drop collinear points, then cut off local self intersections, then split the rest in two
+			if (pass == 0)
+			{
+				EarcutLinked(FilterPoints(ear), indices, 1);
+			}
+			else if (pass == 1)
+			{
+				ear = CureLocalIntersections(FilterPoints(ear), indices);
+				EarcutLinked(ear, indices, 2);
+			}
+			else
+			{
+				SplitEarcut(ear, indices);
+			}
+			break;
+		}
+	}
+}
+
+bool PolygonTriangulator::IsEar(int ear) const
+{
+	const int a = m_Nodes[ear].Prev;
+	const int c = m_Nodes[ear].Next;
+	if (Area(a, ear, c) >= 0.f)
+		return false; //reflex
+
+	//no reflex point of the polygon may lie inside the ear
+	for (int p = m_Nodes[c].Next; p != a; p = m_Nodes[p].Next)
+	{
+		if (IsInTriangle(a, ear, c, p) && Area(m_Nodes[p].Prev, p, m_Nodes[p].Next) >= 0.f)
+			return false;
+	}
+	return true;
+}
+
+bool PolygonTriangulator::IsEarHashed(int ear) const
+{
+	const int a = m_Nodes[ear].Prev;
+	const int c = m_Nodes[ear].Next;
+	if (Area(a, ear, c) >= 0.f)
+		return false; //reflex
+
+	//only the points whose z-order lies within that of the ear's bounds can be inside it, searched both ways from the ear
+	const Node& nodeA = m_Nodes[a];
+	const Node& nodeB = m_Nodes[ear];
+	const Node& nodeC = m_Nodes[c];
+	const unsigned int minZ = GetZOrder(std::min({ nodeA.X, nodeB.X, nodeC.X }), std::min({ nodeA.Y, nodeB.Y, nodeC.Y }));
+	const unsigned int maxZ = GetZOrder(std::max({ nodeA.X, nodeB.X, nodeC.X }), std::max({ nodeA.Y, nodeB.Y, nodeC.Y }));
+	auto isBlocking = [this, a, ear, c](int p)
+	{
+		return p != a && p != c && IsInTriangle(a, ear, c, p) && Area(m_Nodes[p].Prev, p, m_Nodes[p].Next) >= 0.f;
+	};
+
+	int p = m_Nodes[ear].PrevZ;
+	int n = m_Nodes[ear].NextZ;
+	while (p != -1 && m_Nodes[p].Z >= minZ && n != -1 && m_Nodes[n].Z <= maxZ)
+	{
+		if (isBlocking(p) || isBlocking(n))
+			return false;
+		p = m_Nodes[p].PrevZ;
+		n = m_Nodes[n].NextZ;
+	}
+	for (; p != -1 && m_Nodes[p].Z >= minZ; p = m_Nodes[p].PrevZ)
+	{
+		if (isBlocking(p))
+			return false;
+	}
+	for (; n != -1 && m_Nodes[n].Z <= maxZ; n = m_Nodes[n].NextZ)
+	{
+		if (isBlocking(n))
+			return false;
+	}
+	return true;
+}
+
+int PolygonTriangulator::CureLocalIntersections(int start, std::vector<int>& indices)
+{
+	int p = start;
+	do
+	{
+		const int a = m_Nodes[p].Prev;
+		const int b = m_Nodes[m_Nodes[p].Next].Next;
+		if (!IsEqual(a, b) && Intersects(a, p, m_Nodes[p].Next, b) && IsLocallyInside(a, b) && IsLocallyInside(b, a))
+		{
+			indices.push_back(m_Nodes[a].VertexIdx);
+			indices.push_back(m_Nodes[p].VertexIdx);
+			indices.push_back(m_Nodes[b].VertexIdx);
+			RemoveNode(m_Nodes[p].Next);
+			RemoveNode(p);
+			p = start = b;
+		}
+		p = m_Nodes[p].Next;
+	} while (p != start);
+	return FilterPoints(p);
+}
+
+void PolygonTriangulator::SplitEarcut(int start, std::vector<int>& indices)
+{
+	//any valid diagonal splits the polygon in two that are triangulated on their own
+	int a = start;
+	do
+	{
+		for (int b = m_Nodes[m_Nodes[a].Next].Next; b != m_Nodes[a].Prev; b = m_Nodes[b].Next)
+		{
+			if (m_Nodes[a].VertexIdx == m_Nodes[b].VertexIdx || !IsValidDiagonal(a, b))
+				continue;
+
+			int c = SplitPolygon(a, b);
+			a = FilterPoints(a, m_Nodes[a].Next);
+			c = FilterPoints(c, m_Nodes[c].Next);
+			EarcutLinked(a, indices, 0);
+			EarcutLinked(c, indices, 0);
+			return;
+		}
+		a = m_Nodes[a].Next;
+	} while (a != start);
+}
+#pragma endregion //Triangulation
+//----------------------------------------------------------
+#pragma region Holes
+int PolygonTriangulator::EliminateHoles(const std::vector<Vector2>& vertices, int outerNode, float size)
+{
+	//about four vertices per edge cell
+	m_NrOfEdgeCells = Clamp(int(sqrtf(vertices.size() / 4.f)), 1, 512);
+	m_EdgeCellSize = std::max(size / m_NrOfEdgeCells, FLT_EPSILON);
+	m_EdgeCells.resize(m_NrOfEdgeCells * m_NrOfEdgeCells);
+	for (std::vector<int>& cell : m_EdgeCells)
+		cell.clear();
+	int p = outerNode;
+	do
+	{
+		IndexEdge(p);
+		p = m_Nodes[p].Next;
+	} while (p != outerNode);
+
+	//holes are bridged from left to right, each one to the outer shape with every hole left of it already merged in
+	m_HoleQueue.clear();
+	for (size_t h = 0; h < m_HoleStarts.size(); ++h)
+	{
+		const int end = h + 1 < m_HoleStarts.size() ? m_HoleStarts[h + 1] : int(vertices.size());
+		const int hole = LinkShape(vertices, m_HoleStarts[h], end, false);
+		if (hole == -1)
+			continue;
+
+		int leftmost = hole;
+		int p = hole;
+		do
+		{
+			const Node& node = m_Nodes[p];
+			if (node.X < m_Nodes[leftmost].X || (node.X == m_Nodes[leftmost].X && node.Y < m_Nodes[leftmost].Y))
+				leftmost = p;
+			p = node.Next;
+		} while (p != hole);
+		m_HoleQueue.push_back(leftmost);
+	}
+	std::sort(m_HoleQueue.begin(), m_HoleQueue.end(), [this](int a, int b) { return m_Nodes[a].X < m_Nodes[b].X; });
+
+	m_IsIndexingEdges = true;
+	for (int hole : m_HoleQueue)
+	{
+		const int bridge = FindHoleBridge(hole);
+		if (bridge == -1)
+			continue;
+
+		//the hole's edges join the outer shape, collinear points around both cuts are filtered right away
+		p = hole;
+		do
+		{
+			IndexEdge(p);
+			p = m_Nodes[p].Next;
+		} while (p != hole);
+		const int bridgeReverse = SplitPolygon(bridge, hole);
+		FilterPoints(bridgeReverse, m_Nodes[bridgeReverse].Next);
+		outerNode = FilterPoints(bridge, m_Nodes[bridge].Next);
+	}
+	m_IsIndexingEdges = false;
+	return outerNode;
+}
+
+int PolygonTriangulator::FindHoleBridge(int hole) const
+{
+	//David Eberly's bridge: cast a ray left from the hole's leftmost point, the closest edge it hits gives a candidate
+	//the cells of the ray's row are visited from right to left, until a cell can't hold a hit closer than the closest one so far
+	const float hx = m_Nodes[hole].X;
+	const float hy = m_Nodes[hole].Y;
+	float qx = -FLT_MAX;
+	int m = -1;
+	int col, row;
+	GetEdgeCell(hx, hy, col, row);
+	for (; col >= 0 && qx < m_MinX + (col + 1) * m_EdgeCellSize; --col)
+	{
+		for (int p : m_EdgeCells[row * m_NrOfEdgeCells + col])
+		{
+			if (!IsLinked(p))
+				continue;
+			const Node& node = m_Nodes[p];
+			const Node& next = m_Nodes[node.Next];
+			if (hy <= node.Y && hy >= next.Y && next.Y != node.Y)
+			{
+				const float x = node.X + (hy - node.Y) * (next.X - node.X) / (next.Y - node.Y);
+				if (x <= hx && x > qx)
+				{
+					qx = x;
+					m = node.X < next.X ? p : node.Next;
+					if (x == hx)
+						return m; //the hole touches the edge
+				}
+			}
+		}
+	}
+	if (m == -1)
+		return -1;
+
+	//a point inside the triangle of the hole point, the hit and the candidate blocks the view, the one closest in angle to the ray is visible
+	const float mx = m_Nodes[m].X;
+	const float my = m_Nodes[m].Y;
+	const Vector2 a{ hy < my ? hx : qx, hy };
+	const Vector2 c{ hy < my ? qx : hx, hy };
+	//rows are visited outwards from the ray, a row further from it than the smallest angle so far allows ends the search
+	//in every row only the columns between the triangle's sides at the row's edges are visited
+	float tanMin = FLT_MAX;
+	int unusedCol, endRow;
+	GetEdgeCell(mx, my, unusedCol, endRow);
+	GetEdgeCell(hx, hy, col, row);
+	const int rowStep = endRow < row ? -1 : 1;
+	for (endRow += rowStep; row != endRow; row += rowStep)
+	{
+		const float rowMinY = std::max(std::min(hy, my), m_MinY + row * m_EdgeCellSize);
+		const float rowMaxY = std::min(std::max(hy, my), m_MinY + (row + 1) * m_EdgeCellSize);
+		const float distance = rowStep < 0 ? hy - rowMaxY : rowMinY - hy;
+		if (hx > mx && distance / (hx - mx) > tanMin)
+			break;
+
+		//the sides from the candidate to the hit and to the hole point, straight lines so their ends in the row bound them
+		const float t0 = my != hy ? (rowMinY - my) / (hy - my) : 0.f;
+		const float t1 = my != hy ? (rowMaxY - my) / (hy - my) : 1.f;
+		const float margin = m_EdgeCellSize * 0.01f;
+		int minCol, maxCol, unusedRow;
+		GetEdgeCell(mx + std::min(t0, t1) * (qx - mx) - margin, hy, minCol, unusedRow);
+		GetEdgeCell(mx + std::max(t0, t1) * (hx - mx) + margin, hy, maxCol, unusedRow);
+		for (col = minCol; col <= maxCol; ++col)
+		{
+			for (int p : m_EdgeCells[row * m_NrOfEdgeCells + col])
+			{
+				const Node& node = m_Nodes[p];
+				if (!IsLinked(p) || hx < node.X || node.X < mx || hx == node.X || !PointInTriangle({ node.X, node.Y }, a, { mx, my }, c, true))
+					continue;
+
+				const float tan = std::abs(hy - node.Y) / (hx - node.X);
+				if (IsLocallyInside(p, hole)
+					&& (tan < tanMin || (tan == tanMin && (node.X > m_Nodes[m].X || (node.X == m_Nodes[m].X && SectorContainsSector(m, p))))))
+				{
+					m = p;
+					tanMin = tan;
+				}
+			}
+		}
+	}
+	return m;
+}
+
+int PolygonTriangulator::SplitPolygon(int a, int b)
+{
+	//links a to b with a cut, the duplicated ends close the other half, returns b's duplicate
+	const int a2 = int(m_Nodes.size());
+	const int b2 = a2 + 1;
+	m_Nodes.push_back({ m_Nodes[a].VertexIdx, m_Nodes[a].X, m_Nodes[a].Y, -1, -1, 0, -1, -1 });
+	m_Nodes.push_back({ m_Nodes[b].VertexIdx, m_Nodes[b].X, m_Nodes[b].Y, -1, -1, 0, -1, -1 });
+	const int an = m_Nodes[a].Next;
+	const int bp = m_Nodes[b].Prev;
+
+	m_Nodes[a].Next = b;
+	m_Nodes[b].Prev = a;
+	m_Nodes[a2].Next = an;
+	m_Nodes[an].Prev = a2;
+	m_Nodes[b2].Next = a2;
+	m_Nodes[a2].Prev = b2;
+	m_Nodes[bp].Next = b2;
+	m_Nodes[b2].Prev = bp;
+	if (m_IsIndexingEdges)
+	{
+		IndexEdge(a);
+		IndexEdge(a2);
+		IndexEdge(b2);
+		IndexEdge(bp);
+	}
+	return b2;
+}
+
+void PolygonTriangulator::IndexEdge(int node)
+{
+	const Node& from = m_Nodes[node];
+	const Node& to = m_Nodes[from.Next];
+	//only the cells the edge passes through, the bounds of a long diagonal bridge would cover most of the grid
+	//per row the edge is clipped to the row's band, the columns between the clipped ends get it
+	const float minY = std::min(from.Y, to.Y);
+	const float maxY = std::max(from.Y, to.Y);
+	const float dxPerY = from.Y != to.Y ? (to.X - from.X) / (to.Y - from.Y) : 0.f;
+	int col, minRow, maxRow;
+	GetEdgeCell(from.X, minY, col, minRow);
+	GetEdgeCell(from.X, maxY, col, maxRow);
+	for (int row = minRow; row <= maxRow; ++row)
+	{
+		float x0 = from.X, x1 = to.X;
+		if (from.Y != to.Y)
+		{
+			const float y0 = std::max(minY, m_MinY + row * m_EdgeCellSize);
+			const float y1 = std::min(maxY, m_MinY + (row + 1) * m_EdgeCellSize);
+			x0 = from.X + (y0 - from.Y) * dxPerY;
+			x1 = from.X + (y1 - from.Y) * dxPerY;
+		}
+		//a little wider, rounding can't drop the cell the edge just enters
+		const float margin = m_EdgeCellSize * 0.01f;
+		int minCol, maxCol, unusedRow;
+		GetEdgeCell(std::min(x0, x1) - margin, minY, minCol, unusedRow);
+		GetEdgeCell(std::max(x0, x1) + margin, minY, maxCol, unusedRow);
+		for (col = minCol; col <= maxCol; ++col)
+			m_EdgeCells[row * m_NrOfEdgeCells + col].push_back(node);
+	}
+}
+
+void PolygonTriangulator::GetEdgeCell(float x, float y, int& col, int& row) const
+{
+	col = Clamp(int((x - m_MinX) / m_EdgeCellSize), 0, m_NrOfEdgeCells - 1);
+	row = Clamp(int((y - m_MinY) / m_EdgeCellSize), 0, m_NrOfEdgeCells - 1);
+}
+#pragma endregion //Holes
+//----------------------------------------------------------
+#pragma region ZOrder
+unsigned int PolygonTriangulator::GetZOrder(float x, float y) const
+{
+	//interleaves the bits of both coordinates on a 32767 x 32767 grid over the bounds
+	unsigned int ix = static_cast<unsigned int>((x - m_MinX) * m_InvSize);
+	unsigned int iy = static_cast<unsigned int>((y - m_MinY) * m_InvSize);
+	ix = (ix | (ix << 8)) & 0x00FF00FF;
+	ix = (ix | (ix << 4)) & 0x0F0F0F0F;
+	ix = (ix | (ix << 2)) & 0x33333333;
+	ix = (ix | (ix << 1)) & 0x55555555;
+	iy = (iy | (iy << 8)) & 0x00FF00FF;
+	iy = (iy | (iy << 4)) & 0x0F0F0F0F;
+	iy = (iy | (iy << 2)) & 0x33333333;
+	iy = (iy | (iy << 1)) & 0x55555555;
+	return ix | (iy << 1);
+}
+
+void PolygonTriangulator::IndexCurve(int start)
+{
+	int p = start;
+	do
+	{
+		Node& node = m_Nodes[p];
+		node.Z = GetZOrder(node.X, node.Y);
+		node.PrevZ = node.Prev;
+		node.NextZ = node.Next;
+		p = node.Next;
+	} while (p != start);
+
+	m_Nodes[m_Nodes[p].PrevZ].NextZ = -1;
+	m_Nodes[p].PrevZ = -1;
+	SortLinked(p);
+}
+
+int PolygonTriangulator::SortLinked(int list)
+{
+	//bottom up merge sort of the z-order list, runs double in size every pass
+	int inSize = 1;
+	int nrOfMerges;
+	do
+	{
+		int p = list;
+		int tail = -1;
+		list = -1;
+		nrOfMerges = 0;
+		while (p != -1)
+		{
+			++nrOfMerges;
+			int q = p;
+			int pSize = 0;
+			for (int i = 0; i < inSize && q != -1; ++i)
+			{
+				++pSize;
+				q = m_Nodes[q].NextZ;
+			}
+			int qSize = inSize;
+
+			while (pSize > 0 || (qSize > 0 && q != -1))
+			{
+				int e;
+				if (pSize != 0 && (qSize == 0 || q == -1 || m_Nodes[p].Z <= m_Nodes[q].Z))
+				{
+					e = p;
+					p = m_Nodes[p].NextZ;
+					--pSize;
+				}
+				else
+				{
+					e = q;
+					q = m_Nodes[q].NextZ;
+					--qSize;
+				}
+
+				if (tail != -1)
+					m_Nodes[tail].NextZ = e;
+				else
+					list = e;
+				m_Nodes[e].PrevZ = tail;
+				tail = e;
+			}
+			p = q;
+		}
+		m_Nodes[tail].NextZ = -1;
+		inSize *= 2;
+	} while (nrOfMerges > 1);
+	return list;
+}
+#pragma endregion //ZOrder
+//----------------------------------------------------------
+#pragma region Predicates
+float PolygonTriangulator::Area(int p, int q, int r) const
+{
+	//negative when p, q, r turn counter clockwise
+	const Node& a = m_Nodes[p];
+	const Node& b = m_Nodes[q];
+	const Node& c = m_Nodes[r];
+	return (b.Y - a.Y) * (c.X - b.X) - (b.X - a.X) * (c.Y - b.Y);
+}
+
+bool PolygonTriangulator::Intersects(int p1, int q1, int p2, int q2) const
+{
+	auto sign = [](float value) { return value > 0.f ? 1 : (value < 0.f ? -1 : 0); };
+	auto isOnSegment = [this](int p, int q, int r)
+	{
+		const Node& a = m_Nodes[p];
+		const Node& b = m_Nodes[q];
+		const Node& c = m_Nodes[r];
+		return b.X <= std::max(a.X, c.X) && b.X >= std::min(a.X, c.X) && b.Y <= std::max(a.Y, c.Y) && b.Y >= std::min(a.Y, c.Y);
+	};
+
+	const int o1 = sign(Area(p1, q1, p2));
+	const int o2 = sign(Area(p1, q1, q2));
+	const int o3 = sign(Area(p2, q2, p1));
+	const int o4 = sign(Area(p2, q2, q1));
+	if (o1 != o2 && o3 != o4)
+		return true;
+
+	//collinear cases
+	return (o1 == 0 && isOnSegment(p1, p2, q1)) || (o2 == 0 && isOnSegment(p1, q2, q1))
+		|| (o3 == 0 && isOnSegment(p2, p1, q2)) || (o4 == 0 && isOnSegment(p2, q1, q2));
+}
+
+bool PolygonTriangulator::IntersectsPolygon(int a, int b) const
+{
+	const int ai = m_Nodes[a].VertexIdx;
+	const int bi = m_Nodes[b].VertexIdx;
+	int p = a;
+	do
+	{
+		const int next = m_Nodes[p].Next;
+		const int pi = m_Nodes[p].VertexIdx;
+		const int ni = m_Nodes[next].VertexIdx;
+		if (pi != ai && ni != ai && pi != bi && ni != bi && Intersects(p, next, a, b))
+			return true;
+		p = next;
+	} while (p != a);
+	return false;
+}
+
+bool PolygonTriangulator::IsLocallyInside(int a, int b) const
+{
+	//the diagonal a-b leaves a into the polygon
+	const int prev = m_Nodes[a].Prev;
+	const int next = m_Nodes[a].Next;
+	if (Area(prev, a, next) < 0.f)
+		return Area(a, b, next) >= 0.f && Area(a, prev, b) >= 0.f;
+	return Area(a, b, prev) < 0.f || Area(a, next, b) < 0.f;
+}
+
+bool PolygonTriangulator::IsMiddleInside(int a, int b) const
+{
+	//even odd test of the diagonal's midpoint
+	const float px = (m_Nodes[a].X + m_Nodes[b].X) / 2.f;
+	const float py = (m_Nodes[a].Y + m_Nodes[b].Y) / 2.f;
+	bool isInside = false;
+	int p = a;
+	do
+	{
+		const Node& node = m_Nodes[p];
+		const Node& next = m_Nodes[node.Next];
+		if ((node.Y > py) != (next.Y > py) && next.Y != node.Y && px < (next.X - node.X) * (py - node.Y) / (next.Y - node.Y) + node.X)
+			isInside = !isInside;
+		p = node.Next;
+	} while (p != a);
+	return isInside;
+}
+
+bool PolygonTriangulator::IsValidDiagonal(int a, int b) const
+{
+	const Node& nodeA = m_Nodes[a];
+	const Node& nodeB = m_Nodes[b];
+	if (m_Nodes[nodeA.Next].VertexIdx == nodeB.VertexIdx || m_Nodes[nodeA.Prev].VertexIdx == nodeB.VertexIdx || IntersectsPolygon(a, b))
+		return false;
+
+	//a diagonal that doesn't leave the polygon and doesn't make a zero length edge, or a cut between two duplicates of a point
+	const bool isInside = IsLocallyInside(a, b) && IsLocallyInside(b, a) && IsMiddleInside(a, b)
+		&& (Area(nodeA.Prev, a, nodeB.Prev) != 0.f || Area(a, nodeB.Prev, b) != 0.f);
+	const bool isZeroLength = IsEqual(a, b) && Area(nodeA.Prev, a, nodeA.Next) > 0.f && Area(nodeB.Prev, b, nodeB.Next) > 0.f;
+	return isInside || isZeroLength;
+}
+
+bool PolygonTriangulator::SectorContainsSector(int m, int p) const
+{
+	return Area(m_Nodes[m].Prev, m, m_Nodes[p].Prev) < 0.f && Area(m_Nodes[p].Next, m, m_Nodes[m].Next) < 0.f;
+}
+
+bool PolygonTriangulator::IsInTriangle(int a, int b, int c, int p) const
+{
+	const Node& nodeA = m_Nodes[a];
+	const Node& nodeB = m_Nodes[b];
+	const Node& nodeC = m_Nodes[c];
+	const Node& point = m_Nodes[p];
+	return (nodeC.X - point.X) * (nodeA.Y - point.Y) >= (nodeA.X - point.X) * (nodeC.Y - point.Y)
+		&& (nodeA.X - point.X) * (nodeB.Y - point.Y) >= (nodeB.X - point.X) * (nodeA.Y - point.Y)
+		&& (nodeB.X - point.X) * (nodeC.Y - point.Y) >= (nodeC.X - point.X) * (nodeB.Y - point.Y);
+}
+#pragma endregion //Predicates
@@ -0,0 +1,91 @@
+/*=============================================================================*/
+// EPolygonTriangulator.h: ear clipping with hole bridging over contiguous vertex
+// arrays. Unlike Polygon::Triangulate nothing is allocated per vertex or triangle,
+// the triangles come out as indices into one vertex array and large polygons test
+// their ears against z-order sorted vertices only.
+/*=============================================================================*/
+#ifndef ELITE_POLYGON_TRIANGULATOR
+#define	ELITE_POLYGON_TRIANGULATOR
+
+#include "EGeometry2DTypes.h"
+
+namespace Elite
+{
+	class PolygonTriangulator final
+	{
+	public:
+		//=== Constructors & Destructors ===
+		PolygonTriangulator() = default;
+		~PolygonTriangulator() = default;
+
+		//=== Functions ===
+		// vertices gets the outer shape followed by every hole, indices three per triangle, counter clockwise
+		// Any winding is accepted, holes have to lie inside the outer shape without overlapping each other
+		// The buffers are kept between calls, rebuilding a navigation mesh with the same triangulator doesn't allocate
+		void Triangulate(const std::vector<Vector2>& outerShape, const std::vector<std::vector<Vector2>>& holes, std::vector<Vector2>& vertices, std::vector<int>& indices);
+		// Same for a polygon's points with its children as holes
+		void Triangulate(const Polygon& polygon, std::vector<Vector2>& vertices, std::vector<int>& indices);
+
+	private:
+		//=== Datamembers ===
+		// Vertex in the circular list of the remaining polygon, hole bridges duplicate their two ends
+		struct Node
+		{
+			int VertexIdx;
+			float X, Y;
+			int Prev, Next; // in the polygon
+			unsigned int Z; // z-order of the position
+			int PrevZ, NextZ; // in z-order, -1 at the ends
+		};
+		std::vector<Node> m_Nodes;
+		std::vector<int> m_HoleStarts; // first vertex of every hole
+		std::vector<int> m_HoleQueue;
+		float m_MinX = 0.f, m_MinY = 0.f, m_InvSize = 0.f; // z-order grid, m_InvSize is 0 when ears are tested against every vertex
+		//Hole bridges are found against the edges of the merged outer shape, bucketed in a uniform grid over its bounds
+		std::vector<std::vector<int>> m_EdgeCells; // nodes whose edge to the next node overlaps the cell, removed nodes are skipped on lookup
+		int m_NrOfEdgeCells = 0; // per side
+		float m_EdgeCellSize = 0.f;
+		bool m_IsIndexingEdges = false; // while holes are bridged, relinked nodes are added to the grid again
+
+		//=== Functions ===
+		void TriangulateVertices(const std::vector<Vector2>& vertices, std::vector<int>& indices);
+		int LinkShape(const std::vector<Vector2>& vertices, int start, int end, bool isOuter);
+		int InsertNode(int vertexIdx, const Vector2& position, int last);
+		void RemoveNode(int node);
+		int FilterPoints(int start, int end = -1);
+		void EarcutLinked(int ear, std::vector<int>& indices, int pass);
+		bool IsEar(int ear) const;
+		bool IsEarHashed(int ear) const;
+		int CureLocalIntersections(int start, std::vector<int>& indices);
+		void SplitEarcut(int start, std::vector<int>& indices);
+
+		//Holes
+		int EliminateHoles(const std::vector<Vector2>& vertices, int outerNode, float size);
+		int FindHoleBridge(int hole) const;
+		int SplitPolygon(int a, int b);
+		void IndexEdge(int node);
+		void GetEdgeCell(float x, float y, int& col, int& row) const;
+		bool IsLinked(int node) const { return m_Nodes[m_Nodes[node].Next].Prev == node; }
+
+		//Z-order
+		unsigned int GetZOrder(float x, float y) const;
+		void IndexCurve(int start);
+		int SortLinked(int list);
+
+		//Predicates
+		float Area(int p, int q, int r) const;
+		bool IsEqual(int a, int b) const { return m_Nodes[a].X == m_Nodes[b].X && m_Nodes[a].Y == m_Nodes[b].Y; }
+		bool Intersects(int p1, int q1, int p2, int q2) const;
+		bool IntersectsPolygon(int a, int b) const;
+		bool IsLocallyInside(int a, int b) const;
+		bool IsMiddleInside(int a, int b) const;
+		bool IsValidDiagonal(int a, int b) const;
+		bool SectorContainsSector(int m, int p) const;
+		bool IsInTriangle(int a, int b, int c, int p) const;
+
+		//C++ make the class non-copyable
+		PolygonTriangulator(const PolygonTriangulator&) = delete;
+		PolygonTriangulator& operator=(const PolygonTriangulator&) = delete;
+	};
+}
+#endif
@@ -0,0 +1,60 @@
+//Precompiled Header [ALWAYS ON TOP IN CPP]
+#include "stdafx.h"
+#include "EMappedFile.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace Elite;
+
+bool EMappedFile::Open(const std::string& filePath)
+{
+	Close();
+
+#ifdef _WIN32
+	//the view keeps the file and the mapping alive, both handles can be closed right away
+	HANDLE hFile = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER fileSize{};
+	HANDLE hMapping = GetFileSizeEx(hFile, &fileSize) && fileSize.QuadPart > 0 ? CreateFileMappingA(hFile, nullptr, PAGE_WRITECOPY, 0, 0, nullptr) : nullptr;
+	CloseHandle(hFile);
+	if (!hMapping)
+		return false;
+	m_pData = static_cast<unsigned char*>(MapViewOfFile(hMapping, FILE_MAP_COPY, 0, 0, 0));
+	CloseHandle(hMapping);
+	m_Size = m_pData ? size_t(fileSize.QuadPart) : 0;
+#else
+	const int fileDescriptor = open(filePath.c_str(), O_RDONLY);
+	if (fileDescriptor < 0)
+		return false;
+	struct stat fileStats {};
+	void* pView = fstat(fileDescriptor, &fileStats) == 0 && fileStats.st_size > 0
+		? mmap(nullptr, size_t(fileStats.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fileDescriptor, 0) : MAP_FAILED;
+	close(fileDescriptor);
+	m_pData = pView != MAP_FAILED ? static_cast<unsigned char*>(pView) : nullptr;
+	m_Size = m_pData ? size_t(fileStats.st_size) : 0;
+#endif
+	return m_pData != nullptr;
+}
+
+void EMappedFile::Close()
+{
+	if (!m_pData)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(m_pData);
+#else
+	munmap(m_pData, m_Size);
+#endif
+	m_pData = nullptr;
+	m_Size = 0;
+}
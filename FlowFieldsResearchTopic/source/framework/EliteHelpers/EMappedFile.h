@@ -0,0 +1,37 @@
+/*=============================================================================*/
+// EMappedFile.h: file mapped copy-on-write into memory, so file formats can be
+// used in place. Writes to the view stay private and never reach the file.
+/*=============================================================================*/
+#ifndef ELITE_MAPPED_FILE
+#define	ELITE_MAPPED_FILE
+
+namespace Elite
+{
+	class EMappedFile final
+	{
+	public:
+		//=== Constructors & Destructors ===
+		EMappedFile() = default;
+		~EMappedFile() { Close(); }
+
+		// Fails on missing and empty files
+		bool Open(const std::string& filePath);
+		void Close();
+		bool IsOpen() const { return m_pData != nullptr; }
+
+		unsigned char* GetData() const { return m_pData; }
+		size_t GetSize() const { return m_Size; }
+		// True when [offset, offset + size) lies inside the file
+		bool Contains(unsigned long long offset, unsigned long long size) const { return offset <= m_Size && size <= m_Size - offset; }
+
+	private:
+		//=== Datamembers ===
+		unsigned char* m_pData = nullptr;
+		size_t m_Size = 0;
+
+		//C++ make the class non-copyable
+		EMappedFile(const EMappedFile&) = delete;
+		EMappedFile& operator=(const EMappedFile&) = delete;
+	};
+}
+#endif
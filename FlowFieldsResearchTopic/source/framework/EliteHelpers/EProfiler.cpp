@@ -0,0 +1,209 @@
+//Precompiled Header [ALWAYS ON TOP IN CPP]
+#include "stdafx.h"
+#include "EProfiler.h"
+#include <iomanip>
+
+using namespace Elite;
+
+namespace
+{
+	//Buffer of the calling thread, registered on its first zone
+	thread_local void* tl_pThreadBuffer = nullptr;
+
+	void WriteEscaped(std::ofstream& file, const char* pText)
+	{
+		for (const char* pChar = pText; *pChar != '\0'; ++pChar)
+		{
+			if (*pChar == '"' || *pChar == '\\')
+				file << '\\';
+			file << *pChar;
+		}
+	}
+}
+
+long long EProfiler::GetTimeNanoseconds()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+EProfiler::ThreadBuffer* EProfiler::GetThreadBuffer()
+{
+	if (!tl_pThreadBuffer)
+	{
+		std::lock_guard<std::mutex> lock{ m_ThreadsLock };
+		m_Threads.push_back(std::make_unique<ThreadBuffer>());
+		m_Threads.back()->Index = int(m_Threads.size()) - 1;
+		tl_pThreadBuffer = m_Threads.back().get();
+	}
+	return static_cast<ThreadBuffer*>(tl_pThreadBuffer);
+}
+
+void EProfiler::BeginFrame()
+{
+	m_FrameStart = GetTimeNanoseconds();
+}
+
+void EProfiler::EndFrame()
+{
+	ProfileFrame frame;
+	frame.Start = m_FrameStart;
+	frame.End = GetTimeNanoseconds();
+
+	//Gather the zones every thread closed since the last frame
+	{
+		std::lock_guard<std::mutex> threadsLock{ m_ThreadsLock };
+		for (const std::unique_ptr<ThreadBuffer>& pBuffer : m_Threads)
+		{
+			std::lock_guard<std::mutex> bufferLock{ pBuffer->Lock };
+			frame.Zones.insert(frame.Zones.end(), pBuffer->Zones.begin(), pBuffer->Zones.end());
+			pBuffer->Zones.clear();
+		}
+	}
+
+	if (m_IsPaused || frame.Zones.empty())
+		return;
+
+	std::sort(frame.Zones.begin(), frame.Zones.end(), [](const ProfileZone& lh, const ProfileZone& rh) {
+		return lh.ThreadIndex != rh.ThreadIndex ? lh.ThreadIndex < rh.ThreadIndex : lh.Start < rh.Start;
+		});
+
+	m_Frames.push_back(std::move(frame));
+	while (m_Frames.size() > m_MaxFrames)
+	{
+		m_Frames.pop_front();
+		if (m_SelectedFrame > 0)
+			--m_SelectedFrame;
+	}
+}
+
+void EProfiler::BeginZone(const char* pName)
+{
+	ThreadBuffer* pBuffer = GetThreadBuffer();
+	pBuffer->OpenZones.push_back(OpenZone{ pName, GetTimeNanoseconds() });
+}
+
+void EProfiler::EndZone()
+{
+	const long long end = GetTimeNanoseconds();
+	ThreadBuffer* pBuffer = GetThreadBuffer();
+	const OpenZone openZone = pBuffer->OpenZones.back();
+	pBuffer->OpenZones.pop_back();
+
+	std::lock_guard<std::mutex> lock{ pBuffer->Lock };
+	pBuffer->Zones.push_back(ProfileZone{ openZone.pName, openZone.Start, end, int(pBuffer->OpenZones.size()), pBuffer->Index });
+}
+
+bool EProfiler::ExportChromeTrace(const std::string& filePath) const
+{
+	std::ofstream file{ filePath };
+	if (!file.is_open())
+		return false;
+
+	const long long origin = m_Frames.empty() ? 0 : m_Frames.front().Start;
+	int nrOfThreads = 0;
+
+	//Complete events ("X"), timestamps in microseconds
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << std::fixed << std::setprecision(3);
+	bool isFirst = true;
+	for (const ProfileFrame& frame : m_Frames)
+	{
+		for (const ProfileZone& zone : frame.Zones)
+		{
+			file << (isFirst ? "" : ",\n") << "{\"name\":\"";
+			WriteEscaped(file, zone.pName);
+			file << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << zone.ThreadIndex
+				<< ",\"ts\":" << (zone.Start - origin) / 1000.0
+				<< ",\"dur\":" << (zone.End - zone.Start) / 1000.0 << "}";
+			isFirst = false;
+			nrOfThreads = std::max(nrOfThreads, zone.ThreadIndex + 1);
+		}
+	}
+
+	//Metadata so the lanes get readable names
+	for (int i = 0; i < nrOfThreads; ++i)
+	{
+		file << (isFirst ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << i
+			<< ",\"args\":{\"name\":\"" << (i == 0 ? "Main" : "Thread ") << (i == 0 ? "" : std::to_string(i)) << "\"}}";
+		isFirst = false;
+	}
+	file << "\n]}\n";
+	return file.good();
+}
+
+void EProfiler::RenderTimeline()
+{
+#ifdef PLATFORM_WINDOWS
+	ImGui::SetNextWindowSize(ImVec2(700.f, 220.f), ImGuiSetCond_FirstUseEver);
+	if (!ImGui::Begin("Profiler"))
+	{
+		ImGui::End();
+		return;
+	}
+
+	bool isEnabled = IsEnabled();
+	if (ImGui::Checkbox("Enabled", &isEnabled))
+		SetEnabled(isEnabled);
+	ImGui::SameLine();
+	ImGui::Checkbox("Pause", &m_IsPaused);
+	ImGui::SameLine();
+	if (ImGui::Button("Export Chrome Trace"))
+		ExportChromeTrace("profile_trace.json");
+
+	if (m_Frames.empty())
+	{
+		ImGui::Text("No frames recorded");
+		ImGui::End();
+		return;
+	}
+
+	const int latestFrame = int(m_Frames.size()) - 1;
+	int frameIdx = m_SelectedFrame < 0 ? latestFrame : std::min(m_SelectedFrame, latestFrame);
+	if (ImGui::SliderInt("Frame", &frameIdx, 0, latestFrame))
+		m_SelectedFrame = frameIdx == latestFrame ? -1 : frameIdx;
+
+	const ProfileFrame& frame = m_Frames[frameIdx];
+	const float frameDuration = float(std::max(frame.End - frame.Start, 1LL));
+	ImGui::Text("%.3f ms, %d zones", frameDuration / 1000000.f, int(frame.Zones.size()));
+
+	//One lane per thread, one row per zone depth within a lane
+	int nrOfThreads = 0;
+	int nrOfDepths = 0;
+	for (const ProfileZone& zone : frame.Zones)
+	{
+		nrOfThreads = std::max(nrOfThreads, zone.ThreadIndex + 1);
+		nrOfDepths = std::max(nrOfDepths, zone.Depth + 1);
+	}
+
+	const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+	const ImVec2 origin = ImGui::GetCursorScreenPos();
+	const float width = std::max(ImGui::GetContentRegionAvail().x, 1.f);
+	ImDrawList* pDrawList = ImGui::GetWindowDrawList();
+
+	const ProfileZone* pHoveredZone = nullptr;
+	for (const ProfileZone& zone : frame.Zones)
+	{
+		//zones of other threads can start before this frame
+		const float startX = origin.x + Clamp((zone.Start - frame.Start) / frameDuration, 0.f, 1.f) * width;
+		const float endX = origin.x + Clamp((zone.End - frame.Start) / frameDuration, 0.f, 1.f) * width;
+		const float startY = origin.y + (zone.ThreadIndex * nrOfDepths + zone.Depth) * rowHeight;
+		const ImVec2 min{ startX, startY };
+		const ImVec2 max{ std::max(endX, startX + 1.f), startY + rowHeight - 1.f };
+
+		//color per zone name, names are literals so the pointer identifies them
+		const float hue = float(std::hash<const void*>{}(zone.pName) % 360) / 360.f;
+		pDrawList->AddRectFilled(min, max, ImColor::HSV(hue, 0.5f, 0.7f));
+		if (ImGui::CalcTextSize(zone.pName).x < max.x - min.x)
+			pDrawList->AddText(ImVec2(min.x + 2.f, min.y), IM_COL32_WHITE, zone.pName);
+
+		if (ImGui::IsMouseHoveringRect(min, max))
+			pHoveredZone = &zone;
+	}
+	ImGui::Dummy(ImVec2(width, nrOfThreads * nrOfDepths * rowHeight));
+
+	if (pHoveredZone)
+		ImGui::SetTooltip("%s\nthread %d\n%.3f ms", pHoveredZone->pName, pHoveredZone->ThreadIndex, (pHoveredZone->End - pHoveredZone->Start) / 1000000.f);
+
+	ImGui::End();
+#endif
+}
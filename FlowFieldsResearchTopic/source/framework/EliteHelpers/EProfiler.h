@@ -0,0 +1,127 @@
+/*=============================================================================*/
+// EProfiler.h: scoped zone profiler. Zones are recorded per thread and gathered
+// into frames, which can be inspected in an ImGui timeline or exported as a
+// Chrome trace (chrome://tracing, ui.perfetto.dev).
+// Define ELITE_DISABLE_PROFILING to compile all zones out, otherwise a zone costs
+// one flag check while the profiler is disabled.
+/*=============================================================================*/
+#ifndef ELITE_PROFILER
+#define	ELITE_PROFILER
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace Elite
+{
+	struct ProfileZone
+	{
+		const char* pName = nullptr; // zone names are string literals, never copied
+		long long Start = 0; // nanoseconds
+		long long End = 0;
+		int Depth = 0;
+		int ThreadIndex = 0;
+	};
+
+	struct ProfileFrame
+	{
+		long long Start = 0;
+		long long End = 0;
+		std::vector<ProfileZone> Zones;
+	};
+
+	class EProfiler final : public ESingleton<EProfiler>
+	{
+	public:
+		//=== Constructors & Destructors ===
+		EProfiler() = default;
+		~EProfiler() = default;
+
+		//=== Profiler Functions ===
+		void SetEnabled(bool isEnabled) { m_IsEnabled.store(isEnabled, std::memory_order_relaxed); }
+		bool IsEnabled() const { return m_IsEnabled.load(std::memory_order_relaxed); }
+
+		// Called by the main loop, everything recorded in between ends up in one frame
+		void BeginFrame();
+		void EndFrame();
+
+		// Use ELITE_PROFILE_SCOPE instead of calling these directly
+		void BeginZone(const char* pName);
+		void EndZone();
+
+		const std::deque<ProfileFrame>& GetFrames() const { return m_Frames; }
+		void SetMaxFrames(size_t maxFrames) { m_MaxFrames = maxFrames; }
+
+		// Writes all recorded frames in the Chrome trace event format
+		bool ExportChromeTrace(const std::string& filePath) const;
+
+		// ImGui window with the timeline of one recorded frame
+		void RenderTimeline();
+
+		static long long GetTimeNanoseconds();
+
+	private:
+		struct OpenZone
+		{
+			const char* pName;
+			long long Start;
+		};
+
+		struct ThreadBuffer
+		{
+			std::mutex Lock; // only contended while the main thread gathers the frame
+			std::vector<ProfileZone> Zones;
+			std::vector<OpenZone> OpenZones;
+			int Index = 0;
+		};
+
+		//=== Datamembers ===
+		std::atomic<bool> m_IsEnabled{ false };
+		std::mutex m_ThreadsLock;
+		std::vector<std::unique_ptr<ThreadBuffer>> m_Threads;
+
+		std::deque<ProfileFrame> m_Frames;
+		size_t m_MaxFrames = 300;
+		long long m_FrameStart = 0;
+
+		//UI
+		bool m_IsPaused = false;
+		int m_SelectedFrame = -1; // -1 follows the latest frame
+
+		ThreadBuffer* GetThreadBuffer();
+	};
+
+	// Records a zone from construction until destruction
+	class EProfileScope final
+	{
+	public:
+		explicit EProfileScope(const char* pName)
+			: m_IsActive(EProfiler::GetInstance()->IsEnabled())
+		{
+			if (m_IsActive)
+				EProfiler::GetInstance()->BeginZone(pName);
+		}
+		~EProfileScope()
+		{
+			if (m_IsActive)
+				EProfiler::GetInstance()->EndZone();
+		}
+
+	private:
+		bool m_IsActive; // zones started while disabled are not ended either, even when enabled in between
+
+		EProfileScope(const EProfileScope&) = delete;
+		EProfileScope& operator=(const EProfileScope&) = delete;
+	};
+}
+
+#define ELITE_PROFILE_CONCAT_INNER(a, b) a##b
+#define ELITE_PROFILE_CONCAT(a, b) ELITE_PROFILE_CONCAT_INNER(a, b)
+
+#ifdef ELITE_DISABLE_PROFILING
+	#define ELITE_PROFILE_SCOPE(name) ((void)0)
+#else
+	#define ELITE_PROFILE_SCOPE(name) Elite::EProfileScope ELITE_PROFILE_CONCAT(profileScope_, __LINE__)(name)
+#endif
+#endif
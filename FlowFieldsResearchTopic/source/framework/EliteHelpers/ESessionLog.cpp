@@ -0,0 +1,164 @@
+//Precompiled Header [ALWAYS ON TOP IN CPP]
+#include "stdafx.h"
+#include "ESessionLog.h"
+
+using namespace Elite;
+
+namespace
+{
+	//File layout: magic, version, seed, fixed delta, frame count, then per frame the command count
+	//followed by every command (type, value, value count, delta encoded values).
+	//All integers except the header are zigzag varints, an idle frame costs a single byte.
+	const char SESSION_MAGIC[4] = { 'E', 'S', 'L', 'G' };
+	const unsigned int SESSION_VERSION = 1;
+
+	void WriteVarint(std::ofstream& file, int value)
+	{
+		unsigned int zigzag = (static_cast<unsigned int>(value) << 1) ^ static_cast<unsigned int>(value >> 31);
+		do
+		{
+			unsigned char byte = zigzag & 0x7F;
+			zigzag >>= 7;
+			if (zigzag != 0)
+				byte |= 0x80;
+			file.put(char(byte));
+		} while (zigzag != 0);
+	}
+
+	bool ReadVarint(std::ifstream& file, int& value)
+	{
+		unsigned int zigzag = 0;
+		for (int shift = 0; shift < 35; shift += 7)
+		{
+			const int byte = file.get();
+			if (byte == std::char_traits<char>::eof())
+				return false;
+
+			zigzag |= static_cast<unsigned int>(byte & 0x7F) << shift;
+			if ((byte & 0x80) == 0)
+			{
+				value = int(zigzag >> 1) ^ -int(zigzag & 1);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	template<typename T>
+	void WriteRaw(std::ofstream& file, const T& value)
+	{
+		file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template<typename T>
+	bool ReadRaw(std::ifstream& file, T& value)
+	{
+		return bool(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+	}
+}
+
+void ESessionLog::StartRecording(unsigned int seed, float fixedDeltaTime)
+{
+	m_Seed = seed;
+	m_FixedDeltaTime = fixedDeltaTime;
+	m_Frames.clear();
+	m_CurrentFrame = -1;
+	m_IsReplaying = false;
+}
+
+void ESessionLog::AddCommand(const SessionCommand& command)
+{
+	assert(!m_IsReplaying && m_CurrentFrame >= 0 && "<ESessionLog::AddCommand>: not recording a frame");
+	m_Frames[m_CurrentFrame].push_back(command);
+}
+
+void ESessionLog::BeginFrame()
+{
+	if (!m_IsReplaying)
+		m_Frames.emplace_back();
+	++m_CurrentFrame;
+}
+
+bool ESessionLog::Save(const std::string& filePath) const
+{
+	std::ofstream file{ filePath, std::ios::binary };
+	if (!file.is_open())
+		return false;
+
+	file.write(SESSION_MAGIC, sizeof(SESSION_MAGIC));
+	WriteRaw(file, SESSION_VERSION);
+	WriteRaw(file, m_Seed);
+	WriteRaw(file, m_FixedDeltaTime);
+	WriteRaw(file, static_cast<unsigned int>(m_Frames.size()));
+
+	for (const std::vector<SessionCommand>& commands : m_Frames)
+	{
+		WriteVarint(file, int(commands.size()));
+		for (const SessionCommand& command : commands)
+		{
+			file.put(char(command.Type));
+			WriteVarint(file, command.Value);
+			WriteVarint(file, int(command.Values.size()));
+			int previous = 0;
+			for (int value : command.Values)
+			{
+				WriteVarint(file, value - previous);
+				previous = value;
+			}
+		}
+	}
+	return file.good();
+}
+
+bool ESessionLog::Load(const std::string& filePath)
+{
+	std::ifstream file{ filePath, std::ios::binary };
+	if (!file.is_open())
+		return false;
+
+	char magic[4]{};
+	unsigned int version = 0;
+	unsigned int seed = 0;
+	float fixedDeltaTime = 0.f;
+	unsigned int nrOfFrames = 0;
+	if (!file.read(magic, sizeof(magic)) || !std::equal(magic, magic + 4, SESSION_MAGIC)
+		|| !ReadRaw(file, version) || version != SESSION_VERSION
+		|| !ReadRaw(file, seed) || !ReadRaw(file, fixedDeltaTime) || !ReadRaw(file, nrOfFrames))
+		return false;
+
+	std::vector<std::vector<SessionCommand>> frames(nrOfFrames);
+	for (std::vector<SessionCommand>& commands : frames)
+	{
+		int nrOfCommands = 0;
+		if (!ReadVarint(file, nrOfCommands) || nrOfCommands < 0)
+			return false;
+
+		commands.resize(nrOfCommands);
+		for (SessionCommand& command : commands)
+		{
+			const int type = file.get();
+			int nrOfValues = 0;
+			if (type == std::char_traits<char>::eof() || !ReadVarint(file, command.Value) || !ReadVarint(file, nrOfValues) || nrOfValues < 0)
+				return false;
+
+			command.Type = static_cast<unsigned char>(type);
+			command.Values.resize(nrOfValues);
+			int previous = 0;
+			for (int& value : command.Values)
+			{
+				int delta = 0;
+				if (!ReadVarint(file, delta))
+					return false;
+				value = previous + delta;
+				previous = value;
+			}
+		}
+	}
+
+	m_Seed = seed;
+	m_FixedDeltaTime = fixedDeltaTime;
+	m_Frames = std::move(frames);
+	m_CurrentFrame = -1;
+	m_IsReplaying = true;
+	return true;
+}
@@ -0,0 +1,57 @@
+/*=============================================================================*/
+// ESessionLog.h: record of a simulation session (random seed, fixed timestep and
+// the commands applied each frame) so it can be replayed deterministically.
+// Command types and their payload are defined by the app that records them.
+/*=============================================================================*/
+#ifndef ELITE_SESSION_LOG
+#define	ELITE_SESSION_LOG
+
+namespace Elite
+{
+	struct SessionCommand
+	{
+		unsigned char Type = 0;
+		int Value = 0;
+		std::vector<int> Values; // stored delta encoded, so sorted indices are cheapest
+	};
+
+	class ESessionLog final
+	{
+	public:
+		//=== Constructors & Destructors ===
+		ESessionLog() = default;
+		~ESessionLog() = default;
+
+		//=== Recording ===
+		void StartRecording(unsigned int seed, float fixedDeltaTime);
+		void AddCommand(const SessionCommand& command); // added to the current frame
+		bool Save(const std::string& filePath) const;
+
+		//=== Replaying ===
+		bool Load(const std::string& filePath); // the log is replaying after a successful load
+		bool IsReplaying() const { return m_IsReplaying; }
+		bool IsFinished() const { return m_IsReplaying && m_CurrentFrame + 1 >= int(m_Frames.size()); }
+
+		//=== Shared ===
+		// Recording: starts a new, empty frame. Replaying: advances to the next recorded frame
+		void BeginFrame();
+		const std::vector<SessionCommand>& GetCommands() const { return m_Frames[m_CurrentFrame]; }
+		int GetCurrentFrame() const { return m_CurrentFrame; }
+		int GetNrOfFrames() const { return int(m_Frames.size()); }
+		unsigned int GetSeed() const { return m_Seed; }
+		float GetFixedDeltaTime() const { return m_FixedDeltaTime; }
+
+	private:
+		//=== Datamembers ===
+		unsigned int m_Seed = 0;
+		float m_FixedDeltaTime = 1.f / 60.f;
+		std::vector<std::vector<SessionCommand>> m_Frames;
+		int m_CurrentFrame = -1;
+		bool m_IsReplaying = false;
+
+		//C++ make the class non-copyable
+		ESessionLog(const ESessionLog&) = delete;
+		ESessionLog& operator=(const ESessionLog&) = delete;
+	};
+}
+#endif
@@ -0,0 +1,94 @@
+//Precompiled Header [ALWAYS ON TOP IN CPP]
+#include "stdafx.h"
+#include "EWorkerPool.h"
+
+using namespace Elite;
+
+EWorkerPool::EWorkerPool(int nrOfThreads)
+{
+	if (nrOfThreads <= 0)
+		nrOfThreads = std::max(int(std::thread::hardware_concurrency()), 1);
+
+	for (int i = 1; i < nrOfThreads; ++i)
+	{
+		m_Workers.emplace_back(&EWorkerPool::WorkerLoop, this, i);
+	}
+}
+
+EWorkerPool::~EWorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock{ m_Lock };
+		m_IsStopping = true;
+	}
+	m_WorkReady.notify_all();
+	for (std::thread& worker : m_Workers)
+	{
+		worker.join();
+	}
+}
+
+void EWorkerPool::ParallelFor(int count, const std::function<void(int begin, int end, int threadIdx)>& func, int minPerThread)
+{
+	if (count <= 0)
+		return;
+
+	const int nrOfRanges = std::max(1, std::min(GetNrOfThreads(), count / std::max(minPerThread, 1)));
+	if (nrOfRanges == 1)
+	{
+		func(0, count, 0);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock{ m_Lock };
+		m_pJob = &func;
+		m_Count = count;
+		m_NrOfRanges = nrOfRanges;
+		m_NrOfBusyWorkers = nrOfRanges - 1;
+		++m_Generation;
+	}
+	m_WorkReady.notify_all();
+
+	//the calling thread takes the first range
+	RunRange(0);
+
+	std::unique_lock<std::mutex> lock{ m_Lock };
+	m_WorkDone.wait(lock, [this]() { return m_NrOfBusyWorkers == 0; });
+	m_pJob = nullptr;
+}
+
+void EWorkerPool::WorkerLoop(int threadIdx)
+{
+	unsigned int generation = 0;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock{ m_Lock };
+			m_WorkReady.wait(lock, [this, generation]() { return m_IsStopping || m_Generation != generation; });
+			if (m_IsStopping)
+				return;
+
+			generation = m_Generation;
+			if (threadIdx >= m_NrOfRanges)
+				continue; //loop too small to need this worker
+		}
+
+		RunRange(threadIdx);
+
+		bool isLast;
+		{
+			std::lock_guard<std::mutex> lock{ m_Lock };
+			isLast = --m_NrOfBusyWorkers == 0;
+		}
+		if (isLast)
+			m_WorkDone.notify_one();
+	}
+}
+
+void EWorkerPool::RunRange(int rangeIdx) const
+{
+	const int begin = int(static_cast<long long>(m_Count) * rangeIdx / m_NrOfRanges);
+	const int end = int(static_cast<long long>(m_Count) * (rangeIdx + 1) / m_NrOfRanges);
+	(*m_pJob)(begin, end, rangeIdx);
+}
@@ -0,0 +1,50 @@
+/*=============================================================================*/
+// EWorkerPool.h: fixed set of worker threads for fork-join loops. The calling
+// thread takes part in every loop, so a pool of one thread runs everything inline.
+/*=============================================================================*/
+#ifndef ELITE_WORKER_POOL
+#define	ELITE_WORKER_POOL
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace Elite
+{
+	class EWorkerPool final
+	{
+	public:
+		//=== Constructors & Destructors ===
+		explicit EWorkerPool(int nrOfThreads = 0); // 0 uses every hardware thread
+		~EWorkerPool();
+
+		// Including the calling thread
+		int GetNrOfThreads() const { return int(m_Workers.size()) + 1; }
+
+		// Splits [0, count) into one range per thread and blocks until every range is done
+		// Counts below minPerThread per thread use fewer threads, small loops aren't worth the wake up
+		void ParallelFor(int count, const std::function<void(int begin, int end, int threadIdx)>& func, int minPerThread = 1);
+
+	private:
+		//=== Datamembers ===
+		std::vector<std::thread> m_Workers;
+		std::mutex m_Lock;
+		std::condition_variable m_WorkReady;
+		std::condition_variable m_WorkDone;
+
+		const std::function<void(int, int, int)>* m_pJob = nullptr;
+		int m_Count = 0;
+		int m_NrOfRanges = 0;
+		int m_NrOfBusyWorkers = 0;
+		unsigned int m_Generation = 0; // bumped for every loop so workers never run one twice
+		bool m_IsStopping = false;
+
+		void WorkerLoop(int threadIdx);
+		void RunRange(int rangeIdx) const;
+
+		//C++ make the class non-copyable
+		EWorkerPool(const EWorkerPool&) = delete;
+		EWorkerPool& operator=(const EWorkerPool&) = delete;
+	};
+}
+#endif
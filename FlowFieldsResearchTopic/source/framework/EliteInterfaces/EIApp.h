@@ -3,6 +3,8 @@
 //-----------------------------------------------------------------
 // Application Base
 //-----------------------------------------------------------------
+namespace Elite { class ESessionLog; }
+
 class IApp
 {
 public:
@@ -15,8 +17,13 @@ public:
 	virtual void Update(float deltaTime) = 0;
 	virtual void Render(float deltaTime) const = 0;
 
+	//Session recording/replaying, called before Start. Apps that support it record their
+	//commands into the log each Update, or apply the recorded ones instead of reading input
+	virtual void SetSession(Elite::ESessionLog* pSession) { m_pSession = pSession; }
+
 protected:
 	//Datamembers
+	Elite::ESessionLog* m_pSession = nullptr;
 
 private:
 	//C++ make the class non-copyable
@@ -128,6 +128,14 @@ void SDLDebugRenderer2D::Render()
 	}
 }
 
+void SDLDebugRenderer2D::DiscardDrawCalls()
+{
+	m_vTriangles.clear();
+	m_vLines.clear();
+	m_vPoints.clear();
+	m_CurrDepthSlice = DEPTH_SLICE_MAX;
+}
+
 void SDLDebugRenderer2D::Shutdown()
 {
 	m_vPoints.clear();
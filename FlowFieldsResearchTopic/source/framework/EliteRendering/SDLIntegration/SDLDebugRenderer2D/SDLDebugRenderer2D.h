@@ -25,6 +25,7 @@ namespace Elite
 		//--- Functions ---
 		void Initialize(Camera2D* pActiveCamera);
 		void Render();
+		void DiscardDrawCalls(); //drops everything queued this frame without rendering, for headless runs
 		unsigned int LoadShadersToProgram(const char* vertexShaderPath, const char* fragmentShaderPath);
 		unsigned int LoadShadersToProgramFromEmbeddedSource(const char* vertexShader, const char* fragmentShader);
 
@@ -19,6 +19,7 @@ namespace Elite
 		unsigned int width = 901;
 		unsigned int height = 451;
 		bool isResizable = false;
+		bool isHidden = false;
 	};
 
 	template<typename Impl>
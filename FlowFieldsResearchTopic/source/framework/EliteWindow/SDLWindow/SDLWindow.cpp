@@ -35,6 +35,8 @@ void SDLWindow::CreateEWindow(const WindowParams& params)
 	unsigned int flags = SDL_WINDOW_OPENGL; //Default, this is a windows using opengl 
 	if (params.isResizable)
 		flags |= SDL_WINDOW_RESIZABLE;
+	if (params.isHidden)
+		flags |= SDL_WINDOW_HIDDEN;
 
 	//Create window and store pointer (always centered at initialization)
 	m_pWindow = unique_ptr<SDL_Window, SDL_WindowDeleter>(SDL_CreateWindow(
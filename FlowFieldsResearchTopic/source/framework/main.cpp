@@ -1,5 +1,7 @@
 //Precompiled Header [ALWAYS ON TOP IN CPP]
 #include "stdafx.h"
+#include <numeric>
+#include <cstring>
 
 //-----------------------------------------------------------------
 // Includes
@@ -7,6 +9,7 @@
 //Application
 #include "EliteInterfaces/EIApp.h"
 #include "projects/App_Selector.h"
+#include "framework/EliteGeometry/EPolygonTriangulator.h"
 
 //---------- Registered Applications -----------
 #ifdef Sandbox
@@ -34,13 +37,291 @@
 //Hotfix for genetic algorithms project
 bool gRequestShutdown = false;
 
+//Summary of a headless replay on stdout, every frame time in a csv file
+void PrintFrameTimes(std::vector<float> frameTimes, const std::string& csvPath)
+{
+	std::ofstream csv{ csvPath };
+	csv << "frame,ms\n";
+	for (size_t i = 0; i < frameTimes.size(); ++i)
+	{
+		csv << i << "," << frameTimes[i] << "\n";
+	}
+
+	if (frameTimes.empty())
+		return;
+
+	const float total = std::accumulate(frameTimes.begin(), frameTimes.end(), 0.f);
+	std::sort(frameTimes.begin(), frameTimes.end());
+	auto percentile = [&frameTimes](float p) { return frameTimes[size_t(p * (frameTimes.size() - 1))]; };
+	std::cout << "Replayed " << frameTimes.size() << " frames in " << total << " ms" << std::endl
+		<< "mean " << total / frameTimes.size() << " ms, p50 " << percentile(0.5f) << " ms, p95 " << percentile(0.95f)
+		<< " ms, p99 " << percentile(0.99f) << " ms, max " << frameTimes.back() << " ms" << std::endl;
+}
+
+//Navigation mesh rebuild cost: Polygon::Triangulate against PolygonTriangulator on a square with square holes on its diagonal
+//A grid of jittered octagon holes is only timed with PolygonTriangulator, Polygon::Triangulate doesn't find every ear around them
+void PrintTriangulationTimes(int nrOfHoles)
+{
+	const std::vector<Elite::Vector2> outerShape{ { 0.f, 0.f }, { 1000.f, 0.f }, { 1000.f, 1000.f }, { 0.f, 1000.f } };
+	std::vector<std::vector<Elite::Vector2>> holes;
+	const float halfSize = 300.f / nrOfHoles;
+	for (int i = 0; i < nrOfHoles; ++i)
+	{
+		const float center = 20.f + 960.f * (1.f - (i + 0.5f) / nrOfHoles);
+		holes.push_back({ { center - halfSize, center - halfSize }, { center - halfSize, center + halfSize },
+			{ center + halfSize, center + halfSize }, { center + halfSize, center - halfSize } });
+	}
+
+	const int nrOfRuns = 10;
+	long long start = Elite::EProfiler::GetTimeNanoseconds();
+	size_t nrOfTriangles = 0;
+	for (int run = 0; run < nrOfRuns; ++run)
+	{
+		Elite::Polygon polygon{ outerShape, holes };
+		nrOfTriangles = polygon.Triangulate().size();
+	}
+	const float polygonMs = (Elite::EProfiler::GetTimeNanoseconds() - start) / 1e6f / nrOfRuns;
+
+	Elite::PolygonTriangulator triangulator{};
+	std::vector<Elite::Vector2> vertices;
+	std::vector<int> indices;
+	start = Elite::EProfiler::GetTimeNanoseconds();
+	for (int run = 0; run < nrOfRuns; ++run)
+	{
+		triangulator.Triangulate(outerShape, holes, vertices, indices);
+	}
+	const float triangulatorMs = (Elite::EProfiler::GetTimeNanoseconds() - start) / 1e6f / nrOfRuns;
+
+	std::cout << nrOfHoles << " holes, " << vertices.size() << " vertices" << std::endl
+		<< "Polygon::Triangulate " << polygonMs << " ms, " << nrOfTriangles << " triangles" << std::endl
+		<< "PolygonTriangulator " << triangulatorMs << " ms, " << indices.size() / 3 << " triangles" << std::endl;
+
+	//a hole per grid cell, pushed up to an eighth of the cell off center
+	srand(nrOfHoles);
+	holes.clear();
+	const int holesPerRow = int(ceilf(sqrtf(float(nrOfHoles))));
+	const float cellSize = 1000.f / holesPerRow;
+	const float radius = cellSize * 0.3f;
+	for (int i = 0; i < holesPerRow * holesPerRow && int(holes.size()) < nrOfHoles; ++i)
+	{
+		const float centerX = (i / holesPerRow + 0.5f) * cellSize + (rand() % 100 - 50) * cellSize / 400.f;
+		const float centerY = (i % holesPerRow + 0.5f) * cellSize + (rand() % 100 - 50) * cellSize / 400.f;
+		std::vector<Elite::Vector2> octagon;
+		for (int corner = 0; corner < 8; ++corner)
+		{
+			const float angle = -corner * float(E_PI_4); //holes wind clockwise
+			octagon.push_back({ centerX + radius * cosf(angle), centerY + radius * sinf(angle) });
+		}
+		holes.push_back(octagon);
+	}
+
+	start = Elite::EProfiler::GetTimeNanoseconds();
+	for (int run = 0; run < nrOfRuns; ++run)
+	{
+		triangulator.Triangulate(outerShape, holes, vertices, indices);
+	}
+	const float gridMs = (Elite::EProfiler::GetTimeNanoseconds() - start) / 1e6f / nrOfRuns;
+	std::cout << nrOfHoles << " octagon holes in a grid, " << vertices.size() << " vertices" << std::endl
+		<< "PolygonTriangulator " << gridMs << " ms, " << indices.size() / 3 << " triangles" << std::endl;
+}
+
+#ifdef Flowfield
+//Integration scaling: CalculateCellCosts against CalculateCellCostsParallel on a size x size grid with scattered water and mud like the app's map
+//Mud keeps both integrators on their weighted path, the uniform fast path only runs without it
+//The thread count doubles up to maxThreads, every parallel field has to match the serial one exactly
+void PrintIntegrationTimes(int size, int maxThreads)
+{
+	Elite::GridGraph<Elite::GridTerrainNode, Elite::GraphConnection> grid{ size, size, 1, false, true, 1.f, 1.5f, false };
+	srand(1);
+	std::vector<int> waterCells, mudCells;
+	for (int idx = 0; idx < size * size; ++idx)
+	{
+		const int terrain = rand() % 8;
+		if (terrain == 0)
+			waterCells.push_back(idx);
+		else if (terrain == 1)
+			mudCells.push_back(idx);
+	}
+	grid.SetTerrainTypes(waterCells, TerrainType::Water);
+	grid.SetTerrainTypes(mudCells, TerrainType::Mud);
+	grid.SetTerrainType(grid.GetIndex(size / 2, size / 2), TerrainType::Ground);
+
+	Elite::FlowField<Elite::GridTerrainNode, Elite::GraphConnection> flowField{ &grid, Elite::HeuristicFunctions::Octile };
+	Elite::GridTerrainNode* pDestinationNode = grid.GetNode(size / 2, size / 2);
+	const int nrOfRuns = 3;
+	std::vector<float> serialCosts(size * size), parallelCosts(size * size);
+	long long start = Elite::EProfiler::GetTimeNanoseconds();
+	for (int run = 0; run < nrOfRuns; ++run)
+	{
+		flowField.CalculateCellCosts(pDestinationNode, serialCosts);
+	}
+	const float serialMs = (Elite::EProfiler::GetTimeNanoseconds() - start) / 1e6f / nrOfRuns;
+	std::cout << size << "x" << size << " cells, " << std::thread::hardware_concurrency() << " hardware threads" << std::endl
+		<< "CalculateCellCosts " << serialMs << " ms" << std::endl;
+
+	for (int nrOfThreads = 1; nrOfThreads <= maxThreads; nrOfThreads = nrOfThreads < maxThreads ? std::min(nrOfThreads * 2, maxThreads) : maxThreads + 1)
+	{
+		flowField.CalculateCellCostsParallel(pDestinationNode, parallelCosts, nrOfThreads); //starts the workers
+		start = Elite::EProfiler::GetTimeNanoseconds();
+		for (int run = 0; run < nrOfRuns; ++run)
+		{
+			flowField.CalculateCellCostsParallel(pDestinationNode, parallelCosts, nrOfThreads);
+		}
+		const float parallelMs = (Elite::EProfiler::GetTimeNanoseconds() - start) / 1e6f / nrOfRuns;
+		const bool isIdentical = parallelCosts.size() == serialCosts.size()
+			&& std::memcmp(parallelCosts.data(), serialCosts.data(), serialCosts.size() * sizeof(float)) == 0;
+		std::cout << "CalculateCellCostsParallel " << nrOfThreads << " threads " << parallelMs << " ms, speedup " << serialMs / parallelMs
+			<< (isIdentical ? ", identical costs" : ", COSTS DIFFER") << std::endl;
+	}
+}
+
+//Measures the PathMethodCosts of ChoosePathMethod on a size x size grid with a sixth of the cells under water
+//Searches start within a quarter of the grid from the destination, so the flooding searches don't run into the border
+void PrintPathMethodCosts(int size)
+{
+	Elite::GridGraph<Elite::GridTerrainNode, Elite::GraphConnection> grid{ size, size, 1, false, true, 1.f, 1.5f, false };
+	srand(1);
+	std::vector<int> waterCells;
+	for (int idx = 0; idx < size * size; ++idx)
+	{
+		if (rand() % 6 == 0)
+			waterCells.push_back(idx);
+	}
+	grid.SetTerrainTypes(waterCells, TerrainType::Water);
+	grid.SetTerrainType(grid.GetIndex(size / 2, size / 2), TerrainType::Ground);
+
+	Elite::FlowField<Elite::GridTerrainNode, Elite::GraphConnection> flowField{ &grid, Elite::HeuristicFunctions::Octile };
+	Elite::GridTerrainNode* pDestinationNode = grid.GetNode(size / 2, size / 2);
+	const int nrOfRuns = 3;
+	std::vector<float> cellCosts(size * size);
+	std::vector<Elite::Vector2> directions(size * size);
+	long long start = Elite::EProfiler::GetTimeNanoseconds();
+	for (int run = 0; run < nrOfRuns; ++run)
+	{
+		flowField.CalculateCellCosts(pDestinationNode, cellCosts);
+		flowField.CreateFlowField(cellCosts.data(), directions, pDestinationNode);
+	}
+	const float cellNs = float(Elite::EProfiler::GetTimeNanoseconds() - start) / nrOfRuns / (size * size);
+
+	//the same starts with and without a heuristic, a portal link anywhere turns it off
+	const int nrOfSearches = 64;
+	const int range = std::max(size / 4, 1);
+	std::vector<int> startCells;
+	while (int(startCells.size()) < nrOfSearches)
+	{
+		const int col = std::min(std::max(size / 2 + rand() % (2 * range + 1) - range, 0), size - 1);
+		const int row = std::min(std::max(size / 2 + rand() % (2 * range + 1) - range, 0), size - 1);
+		if (grid.IsPassable(grid.GetIndex(col, row)) && cellCosts[grid.GetIndex(col, row)] != FLT_MAX)
+			startCells.push_back(grid.GetIndex(col, row));
+	}
+	auto measureSearches = [&](long long& searchNs, double& expansions, double& distances, double& areas)
+	{
+		std::vector<int> path;
+		searchNs = 0;
+		expansions = distances = areas = 0.0;
+		for (int startIdx : startCells)
+		{
+			start = Elite::EProfiler::GetTimeNanoseconds();
+			flowField.FindPath(startIdx, pDestinationNode->GetIndex(), path);
+			searchNs += Elite::EProfiler::GetTimeNanoseconds() - start;
+			int col, row;
+			grid.GetColRow(startIdx, col, row);
+			const double distance = std::max(abs(col - size / 2), abs(row - size / 2)) + 1;
+			expansions += flowField.GetStats().NodesPopped;
+			distances += distance;
+			areas += distance * distance;
+		}
+	};
+	long long aStarNs, dijkstraNs;
+	double aStarExpansions, dijkstraExpansions, distances, areas;
+	measureSearches(aStarNs, aStarExpansions, distances, areas);
+	grid.AddPortalLink(0, size * size - 1);
+	measureSearches(dijkstraNs, dijkstraExpansions, distances, areas);
+
+	Elite::PathMethodCosts costs;
+	costs.AStarExpansionCost = float((aStarNs + dijkstraNs) / (aStarExpansions + dijkstraExpansions) / cellNs);
+	costs.AStarExpansionsPerCell = float(aStarExpansions / distances);
+	costs.DijkstraExpansionsPerArea = float(dijkstraExpansions / areas);
+	std::cout << size << "x" << size << " cells, flow field " << cellNs << " ns per cell" << std::endl
+		<< "AStarExpansionCost " << costs.AStarExpansionCost << std::endl
+		<< "AStarExpansionsPerCell " << costs.AStarExpansionsPerCell << std::endl
+		<< "DijkstraExpansionsPerArea " << costs.DijkstraExpansionsPerArea << std::endl;
+}
+#endif
+
+//Reads a count argument of the headless modes, false when it isn't a number
+bool ReadCount(const char* argument, int& count)
+{
+	try
+	{
+		count = std::stoi(string(argument));
+	}
+	catch (const std::logic_error&) //invalid_argument and out_of_range
+	{
+		return false;
+	}
+	return true;
+}
+
 //Main
 #undef main //Undefine SDL_main as main
 int main(int argc, char* argv[])
 {
-	srand(static_cast<unsigned>(time(nullptr)));
 	int x{}, y{};
-	bool runExeWithCoordinates{ argc == 3 };
+	//Session arguments: --record <file> records a session, --replay <file> replays one headless
+	bool recordSession{ argc == 3 && string(argv[1]) == "--record" };
+	bool replaySession{ argc == 3 && string(argv[1]) == "--replay" };
+	//--bench-triangulation <holes> times both triangulators and exits without a window
+	bool benchTriangulation{ argc == 3 && string(argv[1]) == "--bench-triangulation" };
+	//--bench-integration <size> <threads> times the serial and parallel integration and exits without a window
+	bool benchIntegration{ argc == 4 && string(argv[1]) == "--bench-integration" };
+	//--bench-path-method <size> measures the cost model of FlowField::ChoosePathMethod and exits without a window
+	bool benchPathMethod{ argc == 3 && string(argv[1]) == "--bench-path-method" };
+	bool runExeWithCoordinates{ argc == 3 && !recordSession && !replaySession && !benchTriangulation && !benchPathMethod };
+
+	if (benchTriangulation)
+	{
+		int nrOfHoles{};
+		if (!ReadCount(argv[2], nrOfHoles))
+		{
+			std::cout << "Usage: --bench-triangulation <holes>" << std::endl;
+			return 1;
+		}
+		PrintTriangulationTimes(std::max(nrOfHoles, 1));
+		return 0;
+	}
+
+	if (benchIntegration)
+	{
+#ifdef Flowfield
+		int size{}, maxThreads{};
+		if (!ReadCount(argv[2], size) || !ReadCount(argv[3], maxThreads))
+		{
+			std::cout << "Usage: --bench-integration <size> <threads>" << std::endl;
+			return 1;
+		}
+		PrintIntegrationTimes(std::max(size, 2), std::max(maxThreads, 1));
+#else
+		std::cout << "--bench-integration needs the Flowfield application" << std::endl;
+#endif
+		return 0;
+	}
+
+	if (benchPathMethod)
+	{
+#ifdef Flowfield
+		int size{};
+		if (!ReadCount(argv[2], size))
+		{
+			std::cout << "Usage: --bench-path-method <size>" << std::endl;
+			return 1;
+		}
+		PrintPathMethodCosts(std::max(size, 2));
+#else
+		std::cout << "--bench-path-method needs the Flowfield application" << std::endl;
+#endif
+		return 0;
+	}
 
 	if (runExeWithCoordinates)
 	{
@@ -50,8 +331,24 @@ int main(int argc, char* argv[])
 
 	try
 	{
+		//Session
+		Elite::ESessionLog* pSession = nullptr;
+		if (recordSession)
+		{
+			pSession = new Elite::ESessionLog();
+			pSession->StartRecording(static_cast<unsigned>(time(nullptr)), 1.f / 60.f);
+		}
+		else if (replaySession)
+		{
+			pSession = new Elite::ESessionLog();
+			if (!pSession->Load(argv[2]))
+				throw Elite_Exception("Session " + string(argv[2]) + " could not be loaded.");
+		}
+		srand(pSession ? pSession->GetSeed() : static_cast<unsigned>(time(nullptr)));
+
 		//Window Creation
 		Elite::WindowParams params;
+		params.isHidden = replaySession; //a GL context is still needed by the debug renderer
 		EliteWindow* pWindow = new EliteWindow();
 		ELITE_ASSERT(pWindow, "Window has not been created.");
 		pWindow->CreateEWindow(params);
@@ -90,38 +387,100 @@ int main(int argc, char* argv[])
 		ELITE_ASSERT(myApp, "Application has not been created.");
 
 		//Boot application
+		myApp->SetSession(pSession);
 		myApp->Start();
 
+		//Headless replay: no input, UI or rendering, only the simulation at full speed
+		if (replaySession)
+		{
+			const float fixedElapsed = pSession->GetFixedDeltaTime();
+			std::vector<float> frameTimes;
+			frameTimes.reserve(pSession->GetNrOfFrames());
+			while (!pSession->IsFinished())
+			{
+				pSession->BeginFrame();
+				PROFILER->BeginFrame();
+				const long long frameStart = Elite::EProfiler::GetTimeNanoseconds();
+				{
+					ELITE_PROFILE_SCOPE("Physics Simulate");
+					PHYSICSWORLD->Simulate(fixedElapsed);
+				}
+				{
+					ELITE_PROFILE_SCOPE("App Update");
+					myApp->Update(fixedElapsed);
+				}
+				frameTimes.push_back((Elite::EProfiler::GetTimeNanoseconds() - frameStart) / 1000000.f);
+				DEBUGRENDERER2D->DiscardDrawCalls();
+				PROFILER->EndFrame();
+			}
+			PrintFrameTimes(frameTimes, string(argv[2]) + ".timings.csv");
+		}
+
 		//Application Loop
-		while (!pWindow->ShutdownRequested())
+		while (!replaySession && !pWindow->ShutdownRequested())
 		{
+			PROFILER->BeginFrame();
+
 			//Timer
 			TIMER->Update();
 			auto elapsed = TIMER->GetElapsed();
 			Elite::Clamp(elapsed, 0.f, 0.1f);
+			if (pSession)
+			{
+				//recorded sessions always step with the fixed delta so a replay matches exactly
+				elapsed = pSession->GetFixedDeltaTime();
+				pSession->BeginFrame();
+			}
 
 			//Window procedure first, to capture all events and input received by the window
-			if (!pImmediateUI->FocussedOnUI())
-				pWindow->ProcedureEWindow();
-			else
-				pImmediateUI->EventProcessing();
+			{
+				ELITE_PROFILE_SCOPE("Window Procedure");
+				if (!pImmediateUI->FocussedOnUI())
+					pWindow->ProcedureEWindow();
+				else
+					pImmediateUI->EventProcessing();
 
-			//New frame Immediate UI (Flush)
-			pImmediateUI->NewFrame(pWindow->GetRawWindowHandle(), elapsed);
+				//New frame Immediate UI (Flush)
+				pImmediateUI->NewFrame(pWindow->GetRawWindowHandle(), elapsed);
+			}
 
 			//Update (Physics, App)
-			PHYSICSWORLD->Simulate(elapsed);
+			{
+				ELITE_PROFILE_SCOPE("Physics Simulate");
+				PHYSICSWORLD->Simulate(elapsed);
+			}
 			pCamera->Update();
-			myApp->Update(elapsed);
+			{
+				ELITE_PROFILE_SCOPE("App Update");
+				myApp->Update(elapsed);
+			}
 
 			//Render and Present Frame
-			PHYSICSWORLD->RenderDebug();
-			myApp->Render(elapsed);
-			pFrame->SubmitAndFlipFrame(pImmediateUI);
+			{
+				ELITE_PROFILE_SCOPE("Physics RenderDebug");
+				PHYSICSWORLD->RenderDebug();
+			}
+			{
+				ELITE_PROFILE_SCOPE("App Render");
+				myApp->Render(elapsed);
+			}
+#ifdef PLATFORM_WINDOWS
+			PROFILER->RenderTimeline();
+#endif
+			{
+				ELITE_PROFILE_SCOPE("Submit And Flip");
+				pFrame->SubmitAndFlipFrame(pImmediateUI);
+			}
+
+			PROFILER->EndFrame();
 		}
 
+		if (recordSession && !pSession->Save(argv[2]))
+			std::cout << "Session could not be saved to " << argv[2] << std::endl;
+
 		//Reversed Deletion
 		SAFE_DELETE(myApp);
+		SAFE_DELETE(pSession);
 		SAFE_DELETE(pImmediateUI);
 		SAFE_DELETE(pCamera);
 		SAFE_DELETE(pFrame);
@@ -132,6 +491,7 @@ int main(int argc, char* argv[])
 		DEBUGRENDERER2D->Destroy();
 		INPUTMANAGER->Destroy();
 		TIMER->Destroy();
+		PROFILER->Destroy();
 	}
 	catch (const Elite_Exception& e)
 	{
@@ -5,7 +5,6 @@
 #include "App_Flowfield.h"
 #include "framework\EliteAI\EliteGraphs\EliteGraphAlgorithms\EBFS.h"
 #include "framework/EliteAI/EliteNavigation/EHeuristicFunctions.h"
-#include "Teleporters.h"
 
 
 using namespace Elite;
@@ -18,14 +17,14 @@ App_FlowFieldPathfinding::~App_FlowFieldPathfinding()
 	{
 		SAFE_DELETE(m_AgentPointers[i]);
 	}
-	for (size_t i = 0; i < m_Obstacles.size(); i++)
-	{
-		SAFE_DELETE(m_Obstacles[i]);
-	}
+	SAFE_DELETE(m_pObstacles);
 	SAFE_DELETE(m_pSteeringBehaviour);
 	SAFE_DELETE(m_pFlee);
 	SAFE_DELETE(m_pSeek);
+	SAFE_DELETE(m_pCellTracker);
 	SAFE_DELETE(m_pFlowfield);
+	SAFE_DELETE(m_pJumpPointSearch);
+	SAFE_DELETE(m_pLandmarks);
 }
 
 //Functions
@@ -39,13 +38,49 @@ void App_FlowFieldPathfinding::Start()
 
 	//Create Graph
 	MakeGridGraph();
-	m_pFlowfield = new FlowField<GridTerrainNode, GraphConnection>(m_pGridGraph, Elite::HeuristicFunctions::Manhattan);
-	RandomizeTeleporter();
+	m_pObstacles = new ObstacleGrid(m_pGridGraph->GetColumns(), m_pGridGraph->GetRows(), float(m_pGridGraph->GetCellSize()));
+	m_pFlowfield = new FlowField<GridTerrainNode, GraphConnection>(m_pGridGraph, Elite::HeuristicFunctions::Octile);
+	m_pJumpPointSearch = new JumpPointSearch<GridTerrainNode, GraphConnection>(m_pGridGraph, true);
+	if (!m_MapFile.IsOpen())
+		RandomizePortals();
+
+	//Loaded maps can start with impassable cells, the obstacle grid is row major
+	for (int idx = 0; idx < m_pGridGraph->GetNrOfNodes(); ++idx)
+	{
+		if (m_pGridGraph->IsPassable(idx))
+			continue;
+		const Elite::Vector2 colRow = m_pGridGraph->GetNodePos(idx);
+		m_pObstacles->Add(int(colRow.y) * m_pGridGraph->GetColumns() + int(colRow.x), m_pGridGraph->GetNodeWorldPos(idx), float(m_pGridGraph->GetCellSize()) / 2.f);
+	}
+
+	m_pLandmarks = new LandmarkTable<GridTerrainNode, GraphConnection>(m_pGridGraph);
+	m_pLandmarks->Build(NR_OF_LANDMARKS);
+
+	//Agent cells, the traffic and portals follow the enter/exit events
+	m_pCellTracker = new CrowdCellTracker<GridTerrainNode, GraphConnection>(m_pGridGraph, m_pFlowfield);
+	m_pCellTracker->AddCellEnterListener([this](SteeringAgent* pAgent, int cellIdx) {
+		m_pFlowfield->AddAgentTraffic(cellIdx, pAgent->GetRadius());
+		if (m_pGridGraph->HasPortalLinks(cellIdx))
+			m_PortalOccupants[cellIdx].push_back(pAgent);
+		//A* paths only cover the cells they pass, an agent pushed off them needs a new one
+		if (m_PathMethod == PathMethod::AStar && cellIdx != endPathIdx && m_FlowFieldVectors[cellIdx] == Elite::ZeroVector2
+			&& m_pFlowfield->GetPortalTarget(cellIdx) == invalid_node_index)
+			m_UpdatePath = true;
+		});
+	m_pCellTracker->AddCellExitListener([this](SteeringAgent* pAgent, int cellIdx) {
+		m_pFlowfield->RemoveAgentTraffic(cellIdx, pAgent->GetRadius());
+		if (m_pGridGraph->HasPortalLinks(cellIdx))
+		{
+			std::vector<SteeringAgent*>& occupants = m_PortalOccupants[cellIdx];
+			occupants.erase(std::remove(occupants.begin(), occupants.end(), pAgent), occupants.end());
+		}
+		});
 	
 	m_CellCosts.resize(m_pGridGraph->GetNrOfNodes());
+	m_pCellCosts = m_CellCosts.data();
 	m_FlowFieldVectors.resize(m_pGridGraph->GetNrOfNodes());
 
-	endPathIdx = 200;
+	endPathIdx = std::min(200, m_pGridGraph->GetNrOfNodes() - 1);
 
 	//Create Agents
 	m_pSeek = new Seek();
@@ -57,10 +92,25 @@ void App_FlowFieldPathfinding::Start()
 	m_WorldTopRight = m_pGridGraph->GetNodeWorldPos(m_pGridGraph->GetNrOfNodes()-1) + Elite::Vector2{ m_pGridGraph->GetCellSize() / 2.5f, m_pGridGraph->GetCellSize() / 2.5f };
 	for (size_t i = 0; i < 50; i++)
 	{
-		m_AgentPointers.push_back(new SteeringAgent());
-		m_AgentPointers[i]->SetPosition(Elite::Vector2{ Elite::randomFloat(m_WorldBotLeft.x, m_WorldTopRight.x), Elite::randomFloat(m_WorldBotLeft.y, m_WorldTopRight.y) });
+		m_AgentPointers.push_back(new SteeringAgent(i % LARGE_AGENT_INTERVAL == 0 ? LARGE_AGENT_RADIUS : 1.f));
+		if (m_SpawnPoints.empty())
+			m_AgentPointers[i]->SetPosition(Elite::Vector2{ Elite::randomFloat(m_WorldBotLeft.x, m_WorldTopRight.x), Elite::randomFloat(m_WorldBotLeft.y, m_WorldTopRight.y) });
+		else
+			m_AgentPointers[i]->SetPosition(m_SpawnPoints[i % m_SpawnPoints.size()]);
 		m_AgentPointers[i]->SetSteeringBehavior(m_pSteeringBehaviour);
 	}
+
+	//a size class per distinct radius, every class gets its own lane in one integration
+	std::vector<float> agentRadii;
+	for (const SteeringAgent* pAgent : m_AgentPointers)
+		agentRadii.push_back(pAgent->GetRadius());
+	std::sort(agentRadii.begin(), agentRadii.end());
+	agentRadii.erase(std::unique(agentRadii.begin(), agentRadii.end()), agentRadii.end());
+	m_pFlowfield->SetSizeClasses(agentRadii);
+	m_SizeClassHash = FlowFieldCache::GetSizeClassHash(m_pFlowfield->GetSizeClassRadii(), m_pGridGraph->GetCellSize(), FlowField<GridTerrainNode, GraphConnection>::MAX_GOALS);
+	m_SizeClassAgents.resize(agentRadii.size());
+	for (SteeringAgent* pAgent : m_AgentPointers)
+		m_SizeClassAgents[m_pFlowfield->GetSizeClass(pAgent->GetRadius())].push_back(pAgent);
 }
 
 void App_FlowFieldPathfinding::Update(float deltaTime)
@@ -68,8 +118,11 @@ void App_FlowFieldPathfinding::Update(float deltaTime)
 	UNREFERENCED_PARAMETER(deltaTime);
 
 	//INPUT
-	bool const middleMousePressed = INPUTMANAGER->IsMouseButtonUp(InputMouseButton::eMiddle);
-	if (middleMousePressed)
+	if (IsReplaying())
+	{
+		ApplySessionCommands(eSetDestination);
+	}
+	else if (INPUTMANAGER->IsMouseButtonUp(InputMouseButton::eMiddle))
 	{
 		MouseData mouseData = { INPUTMANAGER->GetMouseData(Elite::InputType::eMouseButton, Elite::InputMouseButton::eMiddle) };
 		Elite::Vector2 mousePos = DEBUGRENDERER2D->GetActiveCamera()->ConvertScreenToWorld({ (float)mouseData.X, (float)mouseData.Y });
@@ -78,67 +131,176 @@ void App_FlowFieldPathfinding::Update(float deltaTime)
 		int closestNode = m_pGridGraph->GetNodeFromWorldPos(mousePos);
 		endPathIdx = closestNode;
 		m_UpdatePath = true;
+		RecordSessionCommand(eSetDestination, closestNode);
 	}
 
 	//AGENT UPDATE
-	for (SteeringAgent* agent : m_AgentPointers )
 	{
-		switch (m_TeleporterPair.Closest)
+		ELITE_PROFILE_SCOPE("Agent Update");
+		//only agents that crossed a cell border are looked up again, teleporters and traffic react to the cell events
+		m_NrOfCellLookups = 0;
+		for (size_t sizeClass = 0; sizeClass < m_SizeClassAgents.size(); ++sizeClass)
 		{
-		case 1:
-			if (m_pGridGraph->GetNodeFromWorldPos(agent->GetPosition()) == m_TeleporterPair.PositionIndices.second)
-			{
-				agent->SetPosition(m_pGridGraph->GetNodeWorldPos(m_TeleporterPair.PositionIndices.first));
-			}
-			break;
-		case 2:
-			if (m_pGridGraph->GetNodeFromWorldPos(agent->GetPosition()) == m_TeleporterPair.PositionIndices.first)
-			{
-				agent->SetPosition(m_pGridGraph->GetNodeWorldPos(m_TeleporterPair.PositionIndices.second));
-			}
-			break;
-		default:
-			break;
+			m_pCellTracker->Update(m_SizeClassAgents[sizeClass], GetSizeClassFlowField(int(sizeClass)));
+			m_NrOfCellLookups += m_pCellTracker->GetNrOfCellLookups();
 		}
-		float baseSpeed{ 10.f };
+		TeleportAgents();
 
-		if (m_pGridGraph->GetNode(m_pGridGraph->GetNodeFromWorldPos(agent->GetPosition()))->GetTerrainType() == TerrainType::Mud)
-			agent->SetMaxLinearSpeed(baseSpeed / 3.f);
-		else
-			agent->SetMaxLinearSpeed(baseSpeed);
-		Elite::Vector2 seekTarget{agent->GetPosition() + m_FlowFieldVectors[m_pGridGraph->GetNodeFromWorldPos(agent->GetPosition())]};
-		m_pSeek->SetTarget(seekTarget);
-		SetObstacleToAvoid(agent, seekTarget);
-		agent->Update(deltaTime);
-		agent->TrimToWorld(m_WorldBotLeft, m_WorldTopRight);
+		for (SteeringAgent* agent : m_AgentPointers)
+		{
+			const AgentCellCache& cellCache = agent->GetCellCache();
+			float baseSpeed{ 10.f };
+
+			agent->SetMaxLinearSpeed(baseSpeed * cellCache.SpeedFactor);
+			Elite::Vector2 seekTarget{agent->GetPosition() + cellCache.Direction};
+			m_pSeek->SetTarget(seekTarget);
+			SetObstacleToAvoid(agent, seekTarget);
+			agent->Update(deltaTime);
+			agent->TrimToWorld(m_WorldBotLeft, m_WorldTopRight);
+		}
 	}
 
 	//GRID INPUT
-	bool hasGridChanged = m_GraphEditor.UpdateGraph(m_pGridGraph, &m_Obstacles);
+	bool hasGridChanged = false;
+	if (IsReplaying())
+	{
+		hasGridChanged = ApplySessionCommands(eEditCells);
+	}
+	else
+	{
+		hasGridChanged = m_GraphEditor.UpdateGraph(m_pGridGraph, m_pObstacles);
+		if (hasGridChanged)
+			RecordEdit(m_GraphEditor.GetLastEdit());
+	}
 	if (hasGridChanged)
 	{
 		m_UpdatePath = true;
 	}
+	//merged obstacle bodies are rebuilt a few chunks per frame, landmarks one integration per frame
+	m_pObstacles->RebuildDirtyBodies(m_MaxObstacleChunkRebuildsPerFrame);
+	m_pLandmarks->Update();
 
 	//IMGUI
-	UpdateImGui();
+	if (IsReplaying())
+	{
+		ApplySessionCommands(eSetTrafficMultiplier);
+		ApplySessionCommands(eSetTerrainSpeed);
+		ApplySessionCommands(eSetParallelIntegration);
+		ApplySessionCommands(eSaveMap);
+		ApplySessionCommands(eCacheGoal);
+	}
+	else
+	{
+		const float trafficMultiplier = m_TrafficMultiplier;
+		const bool isParallelIntegration = m_bParallelIntegration;
+		UpdateImGui();
+		if (m_TrafficMultiplier != trafficMultiplier)
+			RecordSessionCommand(eSetTrafficMultiplier, FloatToCommandValue(m_TrafficMultiplier));
+		if (m_bParallelIntegration != isParallelIntegration)
+			RecordSessionCommand(eSetParallelIntegration, int(m_bParallelIntegration));
+	}
 
 
 	//CALCULATEPATH
 	//If we have nodes and the target is not the startNode, find a path!
 	auto endNode = m_pGridGraph->GetNode(endPathIdx);
+	bool hasPathChanged = false;
 	if (m_UpdatePath 
 		&& endPathIdx != invalid_node_index)
 	{
 		//FlowField
 
 		//m_vPath = pathfinder.FindPath(startNode, endNode);
-		m_pFlowfield->CalculateCellCosts(endNode, m_CellCosts, &m_TeleporterPair);
+		if (!m_IsTerrainHashed || m_HashedCostFieldVersion != m_pGridGraph->GetCostFieldVersion() || m_HashedPortalLinksVersion != m_pGridGraph->GetPortalLinksVersion())
+		{
+			m_IsTerrainHashed = true;
+			m_HashedCostFieldVersion = m_pGridGraph->GetCostFieldVersion();
+			m_HashedPortalLinksVersion = m_pGridGraph->GetPortalLinksVersion();
+			const unsigned long long terrainHash = FlowFieldCache::GetTerrainHash(*m_pGridGraph);
+			if (terrainHash != m_FlowFieldCache.GetTerrainHash())
+				m_FlowFieldCache.Open(UsesMapFiles() ? FLOW_FIELD_CACHE_PATH : std::string{}, terrainHash);
+		}
+
+		const float* pCachedCosts = nullptr;
+		const Elite::Vector2* pCachedFlowField = nullptr;
+		const float* pCachedLaneCosts = nullptr;
+		const bool isCached = m_FlowFieldCache.Find(endPathIdx, m_SizeClassHash, pCachedCosts, pCachedFlowField, pCachedLaneCosts);
+
+		//a search per agent cell when the group is small or close, cached goals are free either way
+		//the paths ignore clearance, so with several size classes the bigger agents need their class field
+		std::vector<int> agentCells;
+		for (const SteeringAgent* pAgent : m_AgentPointers)
+		{
+			//the cell tracker keeps every agent's cell, only agents it hasn't placed yet are looked up
+			const int cellIdx = pAgent->GetCellCache().CellIdx;
+			agentCells.push_back(cellIdx != invalid_node_index ? cellIdx : m_pGridGraph->GetNodeFromWorldPos(pAgent->GetPosition()));
+		}
+		std::sort(agentCells.begin(), agentCells.end());
+		agentCells.erase(std::unique(agentCells.begin(), agentCells.end()), agentCells.end());
+		const bool canUseAStar = USE_ASTAR_FOR_SMALL_GROUPS && !isCached && m_pFlowfield->GetNrOfSizeClasses() <= 1;
+		m_PathMethod = canUseAStar ? m_pFlowfield->ChoosePathMethod(agentCells, endPathIdx, PATH_METHOD_COSTS) : PathMethod::FlowField;
+
+		if (m_PathMethod == PathMethod::AStar)
+		{
+			//uniform terrain is searched by jumping, the same cheapest paths with far fewer expansions
+			const bool canJump = m_pJumpPointSearch->CanSearch();
+			m_AgentPaths.resize(agentCells.size());
+			for (size_t i = 0; i < agentCells.size(); ++i)
+			{
+				if (!canJump)
+				{
+					m_pFlowfield->FindPath(agentCells[i], endPathIdx, m_AgentPaths[i], [this](int fromIdx, int toIdx) { return m_pLandmarks->GetHeuristicCost(fromIdx, toIdx); });
+					continue;
+				}
+				m_AgentPaths[i].clear();
+				for (const GridTerrainNode* pNode : m_pJumpPointSearch->FindPath(m_pGridGraph->GetNode(agentCells[i]), endNode))
+				{
+					m_AgentPaths[i].push_back(pNode->GetIndex());
+				}
+			}
+			m_pFlowfield->CreatePathFlowField(m_AgentPaths, m_FlowFieldVectors);
+			std::fill(m_CellCosts.begin(), m_CellCosts.end(), FLT_MAX);
+		}
+		else if (isCached)
+			m_pFlowfield->LoadCellCosts(pCachedCosts, endNode);
+		else if (m_bParallelIntegration)
+			m_pFlowfield->CalculateCellCostsParallel(endNode, m_CellCosts);
+		else
+			m_pFlowfield->CalculateCellCosts(endNode, m_CellCosts);
+		//cached costs are read straight from the cache, they stay valid until it is saved or reopened
+		m_pCellCosts = isCached ? pCachedCosts : m_CellCosts.data();
+		//the single field above still drives the cache and the debug drawing, the agents follow their size class
+		if (m_PathMethod == PathMethod::FlowField)
+		{
+			if (isCached)
+				m_pFlowfield->LoadSizeClassCellCosts(pCachedLaneCosts, endNode);
+			else
+				m_pFlowfield->CalculateSizeClassCellCosts(endNode, m_SizeClassCellCosts);
+			m_pSizeClassCellCosts = isCached ? pCachedLaneCosts : m_SizeClassCellCosts.data();
+			m_SizeClassGoals.assign(m_pFlowfield->GetNrOfSizeClasses(), endPathIdx);
+		}
+
+		//the first agent's path is highlighted
+		m_vPath.clear();
+		if (m_PathMethod == PathMethod::AStar && !m_AgentPaths.empty())
+		{
+			for (int idx : m_AgentPaths.front())
+				m_vPath.push_back(m_pGridGraph->GetNode(idx));
+		}
 
 		m_UpdatePath = false;
-		std::cout << "New Path Calculated" << std::endl;
+		hasPathChanged = true;
+	}
+	if (m_PathMethod == PathMethod::FlowField)
+	{
+		m_pFlowfield->CreateFlowField(m_pCellCosts, m_FlowFieldVectors, endNode, true, m_TrafficMultiplier);
+		m_pFlowfield->CreateMultiGoalFlowFields(m_pSizeClassCellCosts, m_SizeClassGoals, m_SizeClassFlowFields, true, m_TrafficMultiplier);
 	}
-	m_pFlowfield->CreateFlowField(m_CellCosts, m_FlowFieldVectors, endNode, &m_AgentPointers, m_TrafficMultiplier);
+	//recalculations are always logged so headless replays show them too
+	if (hasPathChanged)
+		std::cout << "New Path Calculated (" << (m_PathMethod == PathMethod::AStar ? "A*" : "flow field") << "), " << m_pFlowfield->GetStats() << std::endl;
+	else if (m_bLogStats)
+		std::cout << m_pFlowfield->GetStats() << std::endl;
 }
 
 void App_FlowFieldPathfinding::Render(float deltaTime) const
@@ -151,12 +313,23 @@ void App_FlowFieldPathfinding::Render(float deltaTime) const
 		m_bDrawNodeNumbers, 
 		m_bDrawConnections, 
 		m_bDrawConnectionsCosts,
-		&m_CellCosts,
+		m_pCellCosts,
 		m_bDrawCellCosts,
 		&m_FlowFieldVectors,
 		m_bDrawFlowFieldDir
 	);
 
+	//cells with agents on them carry traffic in the flow field
+	if (m_PathMethod == PathMethod::FlowField)
+	{
+		for (const SteeringAgent* pAgent : m_AgentPointers)
+		{
+			const int cellIdx = pAgent->GetCellCache().CellIdx;
+			if (cellIdx != invalid_node_index)
+				DEBUGRENDERER2D->DrawSolidCircle(m_pGridGraph->GetNodeWorldPos(cellIdx), m_pGridGraph->GetCellSize() / 2.f, { 0.f,0.f }, { 0.7f, 0.f, 0.f });
+		}
+	}
+
 	//Render end node on top if applicable
 	if (endPathIdx != invalid_node_index)
 	{
@@ -169,40 +342,214 @@ void App_FlowFieldPathfinding::Render(float deltaTime) const
 		m_GraphRenderer.RenderHighlightedGrid(m_pGridGraph, m_vPath);
 	}
 
-	if (m_bDrawTeleporters)
+	if (m_bDrawPortals)
+	{
+		for (const auto& portalLinks : m_pGridGraph->GetAllPortalLinks())
+		{
+			const Elite::Vector2 portalPos = m_pGridGraph->GetNodeWorldPos(portalLinks.first);
+			DEBUGRENDERER2D->DrawSolidCircle(portalPos, m_pGridGraph->GetCellSize() / 2.f, { 0.f,0.f }, Color{ 0.5f, 0.f, 0.5f }, -1.f);
+			for (const PortalLink& link : portalLinks.second)
+			{
+				DEBUGRENDERER2D->DrawSegment(portalPos, m_pGridGraph->GetNodeWorldPos(link.CellIdx), Color{ 0.5f, 0.f, 0.5f }, -1.f);
+			}
+		}
+	}
+}
+
+void App_FlowFieldPathfinding::TeleportAgents()
+{
+	//only cells with portal links and agents on them are visited
+	//agents follow their size class lane in flow field mode, whose portals can differ from the single field's
+	m_PendingTeleports.clear();
+	for (const auto& occupants : m_PortalOccupants)
+	{
+		for (SteeringAgent* pAgent : occupants.second)
+		{
+			const int targetIdx = m_PathMethod == PathMethod::FlowField
+				? m_pFlowfield->GetLanePortalTarget(occupants.first, m_pFlowfield->GetSizeClass(pAgent->GetRadius()))
+				: m_pFlowfield->GetPortalTarget(occupants.first);
+			if (targetIdx != invalid_node_index)
+				m_PendingTeleports.push_back({ pAgent, targetIdx });
+		}
+	}
+
+	//moving an agent fires its cell events, which edit the occupants
+	for (const std::pair<SteeringAgent*, int>& teleport : m_PendingTeleports)
 	{
-		DEBUGRENDERER2D->DrawSolidCircle(m_pGridGraph->GetNodeWorldPos(m_TeleporterPair.PositionIndices.first), m_pGridGraph->GetCellSize() / 2.f, { 0.f,0.f }, Color{ 0.5f, 0.f, 0.5f }, -1.f);
-		DEBUGRENDERER2D->DrawSolidCircle(m_pGridGraph->GetNodeWorldPos(m_TeleporterPair.PositionIndices.second), m_pGridGraph->GetCellSize() / 2.f, { 0.f,0.f }, Color{ 0.5f, 0.f, 0.5f }, -1.f);
+		teleport.first->SetPosition(m_pGridGraph->GetNodeWorldPos(teleport.second));
+		m_pCellTracker->MoveToCell(teleport.first, teleport.second, GetSizeClassFlowField(m_pFlowfield->GetSizeClass(teleport.first->GetRadius())));
 	}
 }
 
+const std::vector<Elite::Vector2>& App_FlowFieldPathfinding::GetSizeClassFlowField(int sizeClass) const
+{
+	//A* paths are shared by every agent, size class fields only exist once a flow field was integrated
+	if (m_PathMethod == PathMethod::FlowField && sizeClass < int(m_SizeClassFlowFields.size()))
+		return m_SizeClassFlowFields[sizeClass];
+	return m_FlowFieldVectors;
+}
+
 void App_FlowFieldPathfinding::SetObstacleToAvoid(const SteeringAgent* pAgent, const Elite::Vector2& seekTarget)
 {
 	const float avoidanceRadiusSquared{ 70.f };
-	auto closestObstacleIt = std::min_element(m_Obstacles.begin(), m_Obstacles.end(), [pAgent](const Obstacle* lh, const Obstacle* rh) {
-		return Elite::DistanceSquared(pAgent->GetPosition(), lh->GetCenter()) < Elite::DistanceSquared(pAgent->GetPosition(), rh->GetCenter());
-		});
-	if (closestObstacleIt != m_Obstacles.end() && Elite::DistanceSquared((*closestObstacleIt)->GetCenter(), pAgent->GetPosition()) < avoidanceRadiusSquared)
+	//only the cells within the avoidance radius are searched
+	const Obstacle* pClosestObstacle = m_pObstacles->FindClosest(pAgent->GetPosition(), sqrtf(avoidanceRadiusSquared));
+	if (pClosestObstacle)
 	{
-		if (Elite::Dot(seekTarget - pAgent->GetPosition(), (*closestObstacleIt)->GetCenter() - pAgent->GetPosition()) > 0.8f)
+		if (Elite::Dot(seekTarget - pAgent->GetPosition(), pClosestObstacle->GetCenter() - pAgent->GetPosition()) > 0.8f)
 		{
 			std::cout << "avoiding obstacle\n";
-			m_pFlee->SetTarget((*closestObstacleIt)->GetCenter());
+			m_pFlee->SetTarget(pClosestObstacle->GetCenter());
 		}
 	}
 	m_pFlee->SetTarget(pAgent->GetPosition());
 }
 
+bool App_FlowFieldPathfinding::IsReplaying() const
+{
+	return m_pSession && m_pSession->IsReplaying();
+}
+
+void App_FlowFieldPathfinding::RecordSessionCommand(SessionCommandType type, int value, const std::vector<int>& values)
+{
+	if (!m_pSession || m_pSession->IsReplaying())
+		return;
+
+	SessionCommand command;
+	command.Type = type;
+	command.Value = value;
+	command.Values = values;
+	m_pSession->AddCommand(command);
+}
+
+void App_FlowFieldPathfinding::RecordEdit(const GridEditResult& edit)
+{
+	//one command per terrain type, the changed cells are already sorted
+	std::map<int, std::vector<int>> cellsPerTerrain;
+	for (const GridCellChange& change : edit.ChangedCells)
+	{
+		cellsPerTerrain[int(change.NewTerrain)].push_back(change.Index);
+	}
+	for (const auto& cells : cellsPerTerrain)
+	{
+		RecordSessionCommand(eEditCells, cells.first, cells.second);
+	}
+}
+
+bool App_FlowFieldPathfinding::ApplySessionCommands(SessionCommandType type)
+{
+	bool hasApplied = false;
+	for (const SessionCommand& command : m_pSession->GetCommands())
+	{
+		if (command.Type != type)
+			continue;
+
+		switch (type)
+		{
+		case eSetDestination:
+			endPathIdx = command.Value;
+			m_UpdatePath = true;
+			break;
+		case eEditCells:
+		{
+			GridEditTransaction<GridTerrainNode, GraphConnection> edit{ m_pGridGraph };
+			edit.Begin();
+			for (int idx : command.Values)
+			{
+				edit.SetCell(idx, TerrainType(command.Value));
+			}
+			m_GraphEditor.CommitEdit(edit, m_pGridGraph, m_pObstacles);
+			break;
+		}
+		case eSetTrafficMultiplier:
+			m_TrafficMultiplier = CommandValueToFloat(command.Value);
+			break;
+		case eSetTerrainSpeed:
+			m_pGridGraph->SetTerrainSpeed(TerrainType(command.Value), CommandValueToFloat(command.Values[0]));
+			break;
+		case eSetParallelIntegration:
+			m_bParallelIntegration = command.Value != 0;
+			break;
+		case eSaveMap:
+			SaveMap();
+			break;
+		case eCacheGoal:
+			CacheGoalFlowField();
+			break;
+		default:
+			break;
+		}
+		hasApplied = true;
+	}
+	return hasApplied;
+}
+
+void App_FlowFieldPathfinding::SetTerrainSpeed(TerrainType terrain, float speed)
+{
+	m_pGridGraph->SetTerrainSpeed(terrain, speed);
+	RecordSessionCommand(eSetTerrainSpeed, int(terrain), { FloatToCommandValue(speed) });
+}
+
 void App_FlowFieldPathfinding::MakeGridGraph()
 {
-	m_pGridGraph = new GridGraph<GridTerrainNode, GraphConnection>(COLUMNS, ROWS, m_SizeCell, false, true, 1.f, 1.5f);
+	//Mapped maps open without rebuilding the costs, only the nodes and side fields are allocated
+	if (UsesMapFiles() && m_MapFile.Open(MAP_FILE_PATH))
+	{
+		m_pGridGraph = m_MapFile.CreateGraph(false);
+		m_SpawnPoints.assign(m_MapFile.GetSpawnPoints(), m_MapFile.GetSpawnPoints() + m_MapFile.GetNrOfSpawnPoints());
+		return;
+	}
+
+	//No explicit connections, the flow field and editor work on the grid's cost field
+	m_pGridGraph = new GridGraph<GridTerrainNode, GraphConnection>(COLUMNS, ROWS, m_SizeCell, false, true, 1.f, 1.5f, false);
+}
+
+void App_FlowFieldPathfinding::SaveMap()
+{
+	RecordSessionCommand(eSaveMap, 0);
+	//the file can't back the cost field while it gets overwritten
+	m_pGridGraph->UseOwnedCostField();
+	m_MapFile.Close();
+	//a replay leaves the file as it is, sessions don't read it anyway
+	if (IsReplaying())
+		return;
+	if (!EGridMapFile::Save(MAP_FILE_PATH, *m_pGridGraph, m_SpawnPoints))
+		std::cout << "Map could not be saved to " << MAP_FILE_PATH << std::endl;
 }
 
-void App_FlowFieldPathfinding::RandomizeTeleporter()
+void App_FlowFieldPathfinding::CacheGoalFlowField()
 {
-	m_TeleporterPair.PositionIndices.first  = Elite::randomInt(m_pGridGraph->GetNrOfActiveNodes());
-	m_TeleporterPair.PositionIndices.second  = Elite::randomInt(m_pGridGraph->GetNrOfActiveNodes());
-	m_TeleporterPair.Closest = -1;
+	RecordSessionCommand(eCacheGoal, 0);
+	//costs read from the cache belong to this goal already, saving would also unmap them
+	if (m_pCellCosts != m_CellCosts.data())
+		return;
+	//the cached directions leave out traffic, they only depend on the terrain
+	if (m_PathMethod == PathMethod::AStar)
+	{
+		m_pFlowfield->CalculateCellCosts(m_pGridGraph->GetNode(endPathIdx), m_CellCosts);
+		m_pFlowfield->CalculateSizeClassCellCosts(m_pGridGraph->GetNode(endPathIdx), m_SizeClassCellCosts);
+		m_pSizeClassCellCosts = m_SizeClassCellCosts.data();
+		m_SizeClassGoals.assign(m_pFlowfield->GetNrOfSizeClasses(), endPathIdx);
+		m_PathMethod = PathMethod::FlowField; //the agents follow the cached goal from now on
+	}
+	std::vector<Elite::Vector2> flowField(m_pGridGraph->GetNrOfNodes());
+	m_pFlowfield->CreateFlowField(m_CellCosts.data(), flowField, m_pGridGraph->GetNode(endPathIdx));
+	m_FlowFieldCache.Add(endPathIdx, m_SizeClassHash, m_CellCosts, flowField, m_SizeClassCellCosts);
+	if (UsesMapFiles() && !m_FlowFieldCache.Save())
+		std::cout << "Flow field cache could not be saved to " << FLOW_FIELD_CACHE_PATH << std::endl;
+}
+
+void App_FlowFieldPathfinding::RandomizePortals()
+{
+	m_pGridGraph->ClearPortalLinks();
+	for (int i = 0; i < m_NrOfPortalPairs; ++i)
+	{
+		const int first = Elite::randomInt(m_pGridGraph->GetNrOfActiveNodes());
+		const int second = Elite::randomInt(m_pGridGraph->GetNrOfActiveNodes());
+		m_pGridGraph->AddPortalLink(first, second);
+		m_pGridGraph->AddPortalLink(second, first);
+	}
+	m_UpdatePath = true;
 }
 
 void App_FlowFieldPathfinding::UpdateImGui()
@@ -234,6 +581,18 @@ void App_FlowFieldPathfinding::UpdateImGui()
 		ImGui::Indent();
 		ImGui::Text("%.3f ms/frame", 1000.0f / ImGui::GetIO().Framerate);
 		ImGui::Text("%.1f FPS", ImGui::GetIO().Framerate);
+		const FlowFieldStats& stats = m_pFlowfield->GetStats();
+		ImGui::Text("Cell costs (last recalculation)");
+		ImGui::Text("  %d nodes popped", stats.NodesPopped);
+		ImGui::Text("  %d edges relaxed", stats.EdgesRelaxed);
+		ImGui::Text("  %d open list peak", stats.OpenListPeak);
+		ImGui::Text("Flow field");
+		ImGui::Text("  %d directions changed", stats.DirectionsChanged);
+		ImGui::Text("  %d traffic stamps", stats.TrafficStamps);
+		ImGui::Text("  %d agents changed cell", stats.AgentsChangedCell);
+		ImGui::Text("  %d agent cell lookups", m_NrOfCellLookups);
+		ImGui::Checkbox("Log Stats", &m_bLogStats);
+		ImGui::Checkbox("Parallel Integration", &m_bParallelIntegration);
 		ImGui::Unindent();
 
 		/*Spacing*/ImGui::Spacing(); ImGui::Separator(); ImGui::Spacing(); ImGui::Spacing();
@@ -245,8 +604,18 @@ void App_FlowFieldPathfinding::UpdateImGui()
 		ImGui::Checkbox("Connections Costs", &m_bDrawConnectionsCosts);
 		ImGui::Checkbox("Cell Costs", &m_bDrawCellCosts);
 		ImGui::Checkbox("Flow Field Direction", &m_bDrawFlowFieldDir);
-		ImGui::Checkbox("Teleporters", &m_bDrawTeleporters);
+		ImGui::Checkbox("Portals", &m_bDrawPortals);
+		if (ImGui::Button("Save Map"))
+			SaveMap();
+		if (ImGui::Button("Cache Goal"))
+			CacheGoalFlowField();
 		ImGui::SliderFloat("Traffic Multiplier", &m_TrafficMultiplier, 0.f, 10.f);
+		float groundSpeed = m_pGridGraph->GetTerrainSpeed(TerrainType::Ground);
+		if (ImGui::SliderFloat("Ground Speed", &groundSpeed, 0.1f, 2.f))
+			SetTerrainSpeed(TerrainType::Ground, groundSpeed);
+		float mudSpeed = m_pGridGraph->GetTerrainSpeed(TerrainType::Mud);
+		if (ImGui::SliderFloat("Mud Speed", &mudSpeed, 0.1f, 2.f))
+			SetTerrainSpeed(TerrainType::Mud, mudSpeed);
 		ImGui::Spacing();
 
 		//End
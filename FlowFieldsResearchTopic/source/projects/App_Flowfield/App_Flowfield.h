@@ -7,11 +7,15 @@
 #include "framework\EliteAI\EliteGraphs\EGridGraph.h"
 #include "framework\EliteAI\EliteGraphs\EliteGraphUtilities\EGraphEditor.h"
 #include "framework\EliteAI\EliteGraphs\EliteGraphUtilities\EGraphRenderer.h"
+#include "framework\EliteAI\EliteGraphs\EliteGraphUtilities\EGridMapFile.h"
+#include "framework\EliteAI\EliteGraphs\EliteGraphAlgorithms\EJumpPointSearch.h"
 #include "FlowField.h"
+#include "FlowFieldCache.h"
 #include "SteeringAgent.h"
 #include "SteeringBehaviors.h"
 #include "CombinedSteeringBehaviors.h"
-#include "Teleporters.h"
+#include "CrowdCellTracker.h"
+#include "LandmarkTable.h"
 
 
 //-----------------------------------------------------------------
@@ -32,6 +36,7 @@ public:
 private:
 	//Datamembers
 	const bool ALLOW_DIAGONAL_MOVEMENT = true;
+	const bool USE_ASTAR_FOR_SMALL_GROUPS = true; // a constant so session replays choose like the recording did
 	Elite::Vector2 m_StartPosition = Elite::ZeroVector2;
 	Elite::Vector2 m_TargetPosition = Elite::ZeroVector2;
 	Elite::Vector2 m_WorldBotLeft;
@@ -43,22 +48,53 @@ private:
 	unsigned int m_SizeCell = 5;
 	Elite::GridGraph<Elite::GridTerrainNode, Elite::GraphConnection>* m_pGridGraph;
 	std::vector<float> m_CellCosts;
+	const float* m_pCellCosts = nullptr; // m_CellCosts, or the cached costs of the goal used in place
 	std::vector<Elite::Vector2> m_FlowFieldVectors;
 	FlowField<GridTerrainNode, GraphConnection>* m_pFlowfield;
 
+	//Map file, opened at start when it exists and backs the grid's cost field from then on, outside sessions
+	const std::string MAP_FILE_PATH = "flowfield.egmap";
+	Elite::EGridMapFile m_MapFile;
+	std::vector<Elite::Vector2> m_SpawnPoints; // agents spawn at random positions without any
+
+	//Flow fields of static goals, reopened whenever the terrain hash changes, kept in memory during sessions
+	const std::string FLOW_FIELD_CACHE_PATH = "flowfield.effc";
+	FlowFieldCache m_FlowFieldCache;
+	unsigned long long m_SizeClassHash = 0;
+	//the terrain hash reads the whole cost field, it is only taken again once the grid changed
+	bool m_IsTerrainHashed = false;
+	unsigned int m_HashedCostFieldVersion = 0;
+	unsigned int m_HashedPortalLinksVersion = 0;
+	void CacheGoalFlowField();
 
 	//Agents
 	std::vector<SteeringAgent*> m_AgentPointers;
+	CrowdCellTracker<GridTerrainNode, GraphConnection>* m_pCellTracker = nullptr;
 	BlendedSteering* m_pSteeringBehaviour;
 	Seek* m_pSeek;
 	Flee* m_pFlee;
 	void SetObstacleToAvoid(const SteeringAgent* pAgent, const Elite::Vector2& seekTarget);
+	int m_NrOfCellLookups = 0; // of every size class together
+
+	//Size classes: agents only follow cells their radius fits in, one flow field per distinct radius
+	const float LARGE_AGENT_RADIUS = 3.f;
+	const int LARGE_AGENT_INTERVAL = 5; // every fifth agent is a large one
+	std::vector<std::vector<SteeringAgent*>> m_SizeClassAgents;
+	std::vector<int> m_SizeClassGoals; // the destination once per class
+	std::vector<float> m_SizeClassCellCosts;
+	const float* m_pSizeClassCellCosts = nullptr; // like m_pCellCosts
+	std::vector<std::vector<Elite::Vector2>> m_SizeClassFlowFields;
+	const std::vector<Elite::Vector2>& GetSizeClassFlowField(int sizeClass) const;
 	
 	//Obstacles
-	std::vector<Obstacle*> m_Obstacles;
+	ObstacleGrid* m_pObstacles = nullptr;
+	int m_MaxObstacleChunkRebuildsPerFrame{ 4 };
 
-	//Teleporters
-	TeleporterPair m_TeleporterPair;
+	//Portals, linked both ways at no cost
+	int m_NrOfPortalPairs{ 1 };
+	std::unordered_map<int, std::vector<SteeringAgent*>> m_PortalOccupants; // agents per cell with outgoing portal links
+	std::vector<std::pair<SteeringAgent*, int>> m_PendingTeleports;
+	void TeleportAgents();
 
 	//Traffic
 	float m_TrafficMultiplier{1.f};
@@ -66,6 +102,12 @@ private:
 
 	//Pathfinding datamembers
 	int endPathIdx = invalid_node_index;
+	Elite::PathMethod m_PathMethod = Elite::PathMethod::FlowField; // of the last recalculation
+	const Elite::PathMethodCosts PATH_METHOD_COSTS{}; // the measured defaults, see --bench-path-method
+	std::vector<std::vector<int>> m_AgentPaths; // per distinct agent cell, when A* was chosen
+	Elite::JumpPointSearch<Elite::GridTerrainNode, Elite::GraphConnection>* m_pJumpPointSearch = nullptr; // replaces A* on uniform terrain
+	LandmarkTable<GridTerrainNode, GraphConnection>* m_pLandmarks = nullptr; // A* heuristic everywhere else
+	const int NR_OF_LANDMARKS = 8;
 	std::vector<Elite::GridTerrainNode*> m_vPath;
 	bool m_UpdatePath = true;
 
@@ -74,18 +116,42 @@ private:
 	Elite::EGraphRenderer m_GraphRenderer{};
 
 	//Debug rendering information
-	bool m_bDrawTeleporters = true;
+	bool m_bDrawPortals = true;
 	bool m_bDrawGrid = true;
 	bool m_bDrawNodeNumbers = false;
 	bool m_bDrawConnections = false;
 	bool m_bDrawConnectionsCosts = false;
 	bool m_bDrawCellCosts = false;
 	bool m_bDrawFlowFieldDir = false;
+	bool m_bLogStats = false;
+	bool m_bParallelIntegration = false; // same costs, only worth it on big grids
 	bool m_StartSelected = true;
 
+	//Session commands, see ESessionLog
+	enum SessionCommandType : unsigned char
+	{
+		eSetDestination, //Value: destination cell
+		eEditCells, //Value: terrain type, Values: cells
+		eSetTrafficMultiplier, //Value: float bits
+		eSetTerrainSpeed, //Value: terrain type, Values: float bits
+		eSetParallelIntegration, //Value: 0 or 1
+		eSaveMap,
+		eCacheGoal
+	};
+	bool IsReplaying() const;
+	// Sessions never read the map or cache file, a replay would depend on whatever they hold by then
+	bool UsesMapFiles() const { return !m_pSession; }
+	void RecordSessionCommand(SessionCommandType type, int value, const std::vector<int>& values = {});
+	void RecordEdit(const Elite::GridEditResult& edit);
+	bool ApplySessionCommands(SessionCommandType type);
+	static int FloatToCommandValue(float value) { int bits; memcpy(&bits, &value, sizeof(float)); return bits; }
+	static float CommandValueToFloat(int bits) { float value; memcpy(&value, &bits, sizeof(float)); return value; }
+
 	//Functions
 	void MakeGridGraph();
-	void RandomizeTeleporter();
+	void SaveMap();
+	void SetTerrainSpeed(TerrainType terrain, float speed);
+	void RandomizePortals();
 	void UpdateImGui();
 
 	//C++ make the class non-copyable
@@ -0,0 +1,145 @@
+#pragma once
+#include "FlowField.h"
+#include "SteeringAgent.h"
+#include <functional>
+
+// Keeps the AgentCellCache of every agent up to date
+// Only agents that left their cached cell are looked up again (batched), a new field version only re-reads the cached cell
+// Systems that care about where agents are subscribe to the cell enter/exit events instead of polling every agent
+template<class T_NodeType, class T_ConnectionType>
+class CrowdCellTracker final
+{
+public:
+	using CellEvent = std::function<void(SteeringAgent* pAgent, int cellIdx)>;
+
+	CrowdCellTracker(Elite::GridGraph<T_NodeType, T_ConnectionType>* pGraph, const Elite::FlowField<T_NodeType, T_ConnectionType>* pFlowField);
+	~CrowdCellTracker() = default;
+
+	void AddCellEnterListener(const CellEvent& listener) { m_EnterListeners.push_back(listener); }
+	void AddCellExitListener(const CellEvent& listener) { m_ExitListeners.push_back(listener); }
+
+	void Update(const std::vector<SteeringAgent*>& agents, const std::vector<Elite::Vector2>& flowField);
+	// Moves the cache to a known cell right away, e.g. after a teleport
+	void MoveToCell(SteeringAgent* pAgent, int cellIdx, const std::vector<Elite::Vector2>& flowField);
+	// Fires the exit event of the agent's cell, call before the agent is removed
+	void Remove(SteeringAgent* pAgent);
+
+	int GetNrOfCellLookups() const { return m_NrOfCellLookups; } // during the last Update
+
+private:
+	Elite::GridGraph<T_NodeType, T_ConnectionType>* m_pGraph;
+	const Elite::FlowField<T_NodeType, T_ConnectionType>* m_pFlowField;
+	std::vector<CellEvent> m_EnterListeners;
+	std::vector<CellEvent> m_ExitListeners;
+
+	std::vector<SteeringAgent*> m_CrossedAgents;
+	std::vector<Elite::Vector2> m_CrossedPositions;
+	Elite::FlowSamples m_Samples;
+	int m_NrOfCellLookups = 0;
+
+	void SetCell(SteeringAgent* pAgent, int cellIdx);
+	void Refresh(AgentCellCache& cache, const std::vector<Elite::Vector2>& flowField) const;
+
+	//C++ make the class non-copyable
+	CrowdCellTracker(const CrowdCellTracker&) = delete;
+	CrowdCellTracker& operator=(const CrowdCellTracker&) = delete;
+};
+
+template<class T_NodeType, class T_ConnectionType>
+CrowdCellTracker<T_NodeType, T_ConnectionType>::CrowdCellTracker(Elite::GridGraph<T_NodeType, T_ConnectionType>* pGraph, const Elite::FlowField<T_NodeType, T_ConnectionType>* pFlowField)
+	: m_pGraph(pGraph)
+	, m_pFlowField(pFlowField)
+{
+}
+
+template<class T_NodeType, class T_ConnectionType>
+void CrowdCellTracker<T_NodeType, T_ConnectionType>::Update(const std::vector<SteeringAgent*>& agents, const std::vector<Elite::Vector2>& flowField)
+{
+	m_CrossedAgents.clear();
+	m_CrossedPositions.clear();
+	for (SteeringAgent* pAgent : agents)
+	{
+		AgentCellCache& cache = pAgent->GetCellCache();
+		if (!cache.Contains(pAgent->GetPosition()))
+		{
+			m_CrossedAgents.push_back(pAgent);
+			m_CrossedPositions.push_back(pAgent->GetPosition());
+		}
+		else if (cache.FieldVersion != m_pFlowField->GetVersion())
+		{
+			Refresh(cache, flowField);
+		}
+	}
+
+	m_NrOfCellLookups = int(m_CrossedAgents.size());
+	if (m_CrossedAgents.empty())
+		return;
+
+	m_pFlowField->SampleFlowField(m_CrossedPositions, flowField, m_Samples);
+	for (size_t i = 0; i < m_CrossedAgents.size(); ++i)
+	{
+		SetCell(m_CrossedAgents[i], m_Samples.Cells[i]);
+
+		AgentCellCache& cache = m_CrossedAgents[i]->GetCellCache();
+		cache.Direction = m_Samples.Directions[i];
+		cache.SpeedFactor = m_Samples.SpeedFactors[i];
+		cache.FieldVersion = m_pFlowField->GetVersion();
+	}
+}
+
+template<class T_NodeType, class T_ConnectionType>
+void CrowdCellTracker<T_NodeType, T_ConnectionType>::MoveToCell(SteeringAgent* pAgent, int cellIdx, const std::vector<Elite::Vector2>& flowField)
+{
+	SetCell(pAgent, cellIdx);
+	Refresh(pAgent->GetCellCache(), flowField);
+}
+
+template<class T_NodeType, class T_ConnectionType>
+void CrowdCellTracker<T_NodeType, T_ConnectionType>::Remove(SteeringAgent* pAgent)
+{
+	SetCell(pAgent, invalid_node_index);
+}
+
+template<class T_NodeType, class T_ConnectionType>
+void CrowdCellTracker<T_NodeType, T_ConnectionType>::SetCell(SteeringAgent* pAgent, int cellIdx)
+{
+	AgentCellCache& cache = pAgent->GetCellCache();
+	const int previousCellIdx = cache.CellIdx;
+	if (previousCellIdx == cellIdx)
+		return;
+
+	cache.CellIdx = cellIdx;
+	if (cellIdx == invalid_node_index)
+	{
+		cache.CellMin = cache.CellMax = Elite::ZeroVector2; //contains nothing, the next Update looks the agent up again
+	}
+	else
+	{
+		//border cells reach to infinity, the batched lookup clamps positions outside the grid to them
+		const Elite::Vector2 colRow = m_pGraph->GetNodePos(cellIdx);
+		const float cellSize = float(m_pGraph->GetCellSize());
+		cache.CellMin.x = colRow.x == 0 ? -FLT_MAX : colRow.x * cellSize;
+		cache.CellMin.y = colRow.y == 0 ? -FLT_MAX : colRow.y * cellSize;
+		cache.CellMax.x = colRow.x == m_pGraph->GetColumns() - 1 ? FLT_MAX : (colRow.x + 1) * cellSize;
+		cache.CellMax.y = colRow.y == m_pGraph->GetRows() - 1 ? FLT_MAX : (colRow.y + 1) * cellSize;
+	}
+
+	if (previousCellIdx != invalid_node_index)
+	{
+		for (const CellEvent& listener : m_ExitListeners)
+			listener(pAgent, previousCellIdx);
+	}
+	if (cellIdx != invalid_node_index)
+	{
+		for (const CellEvent& listener : m_EnterListeners)
+			listener(pAgent, cellIdx);
+	}
+}
+
+template<class T_NodeType, class T_ConnectionType>
+void CrowdCellTracker<T_NodeType, T_ConnectionType>::Refresh(AgentCellCache& cache, const std::vector<Elite::Vector2>& flowField) const
+{
+	cache.Direction = flowField[cache.CellIdx];
+	cache.SpeedFactor = m_pFlowField->GetSpeedFactor(cache.CellIdx);
+	cache.FieldVersion = m_pFlowField->GetVersion();
+}
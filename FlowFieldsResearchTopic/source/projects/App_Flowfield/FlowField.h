@@ -1,26 +1,87 @@
 #pragma once
-#include "Teleporters.h"
 #include "SteeringAgent.h"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
 #include <vector>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 namespace Elite
 {
-	template <class T_NodeType, class T_ConnectionType>
+	// Algorithmic counters of the last CalculateCellCosts and CreateFlowField calls
+	struct FlowFieldStats
+	{
+		//CalculateCellCosts
+		int NodesPopped = 0; // including outdated records that were skipped
+		int EdgesRelaxed = 0; // neighbours whose cost got lowered
+		int OpenListPeak = 0;
+		int BfsLevels = 0; // cost levels flooded by the uniform cost fast path, 0 when it didn't apply
+
+		//CreateFlowField
+		int DirectionsChanged = 0;
+		int TrafficStamps = 0;
+		int AgentsChangedCell = 0;
+
+		//CalculateMultiGoalCellCosts
+		int SweepPasses = 0;
+	};
+
+	inline std::ostream& operator<<(std::ostream& os, const FlowFieldStats& stats)
+	{
+		return os << "popped: " << stats.NodesPopped
+			<< " relaxed: " << stats.EdgesRelaxed
+			<< " open peak: " << stats.OpenListPeak
+			<< " bfs levels: " << stats.BfsLevels
+			<< " directions changed: " << stats.DirectionsChanged
+			<< " traffic stamps: " << stats.TrafficStamps
+			<< " agents changed cell: " << stats.AgentsChangedCell
+			<< " sweep passes: " << stats.SweepPasses;
+	}
+
+	// How FlowField::ChoosePathMethod answers a move order
+	enum class PathMethod
+	{
+		AStar, // a FindPath per start cell, followed through CreatePathFlowField
+		FlowField // one integration of the whole grid
+	};
+
+	// Cost model of FlowField::ChoosePathMethod, in flow field cells: integrating and orienting one cell
+	// The defaults come from --bench-path-method 256, a 256x256 grid with a sixth of the cells blocked
+	struct PathMethodCosts
+	{
+		float AStarExpansionCost = 2.f; // heap and heuristic work of one A* expansion
+		float AStarExpansionsPerCell = 13.f; // cells A* expands per cell of distance
+		float DijkstraExpansionsPerArea = 3.4f; // without a heuristic (portal links) A* floods an area, cells expanded per squared distance
+	};
+
+	// Per position results of FlowField::SampleFlowField, stored per attribute
+	struct FlowSamples
+	{
+		std::vector<int> Cells;
+		std::vector<float> SpeedFactors;
+		std::vector<Vector2> Directions;
+	};
+
+	// Connectivity and cost model have to match the graph's, see EGridPolicies.h; the defaults are configured at runtime
+	template <class T_NodeType, class T_ConnectionType, class T_Connectivity = RuntimeConnectivity, class T_CostModel = CostFieldCost, class T_Heuristic = RuntimeHeuristic>
 	class FlowField
 	{
 	public:
-		FlowField(GridGraph<T_NodeType, T_ConnectionType>* pGraph, Heuristic hFunction);
+		FlowField(GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>* pGraph, T_Heuristic heuristic = T_Heuristic());
 		
 		// stores the optimal connection to a node and its total costs related to the start and end node of the path
 		struct NodeRecord
 		{
-			T_NodeType* pNode = nullptr;
+			int nodeIdx = invalid_node_index; // cells are integrated by index, nodes of large grids are only created when asked for
 			float costSoFar = 0.f; // accumulated g-costs of all the connections leading up to this one
 			float estimatedTotalCost = 0.f; // f-cost (= costSoFar + h-cost)
 
 			bool operator==(const NodeRecord& other) const
 			{
-				return pNode == other.pNode;
+				return nodeIdx == other.nodeIdx;
 			};
 
 			bool operator<(const NodeRecord& other) const
@@ -28,136 +89,1114 @@ namespace Elite
 				return costSoFar < other.costSoFar;
 			};
 		};
-		void CalculateCellCosts(T_NodeType* pDestinationNode, std::vector<float>& cellCosts, TeleporterPair* teleporterPair = nullptr );
-		void CreateFlowField(const std::vector<float>& cellCosts, std::vector<Vector2>& flowField, const T_NodeType* endNode, const std::vector<SteeringAgent*>* pAgents = nullptr, float trafficPerAgentMul = 1.f);
+		void CalculateCellCosts(T_NodeType* pDestinationNode, std::vector<float>& cellCosts);
+		// Delta-stepping on a worker pool, the costs are identical to CalculateCellCosts
+		// Cells are bucketed by cost / delta, the default fits one diagonal ground step
+		void CalculateCellCostsParallel(T_NodeType* pDestinationNode, std::vector<float>& cellCosts, int nrOfThreads = 0, float delta = 1.5f);
+		void CreateFlowField(const float* pCellCosts, std::vector<Vector2>& flowField, const T_NodeType* endNode, bool applyTraffic = false, float trafficPerAgentMul = 1.f);
+		// Takes over costs integrated earlier for the same terrain and destination, e.g. from a FlowFieldCache
+		// The costs are used in place, hand pCachedCosts to CreateFlowField for as long as they stay valid
+		void LoadCellCosts(const float* pCachedCosts, T_NodeType* pDestinationNode);
+
+		// Multi goal mode: up to MAX_GOALS goals are integrated together, every relaxation updates all of them at once
+		// laneCosts interleaves the goals per cell, the cost of cell i to goal g is laneCosts[i * MAX_GOALS + g]
+		static const int MAX_GOALS = 8;
+		void CalculateMultiGoalCellCosts(const std::vector<int>& goalIndices, std::vector<float>& laneCosts);
+		// flowFields[g] is the flow field towards goalIndices[g], cells that should take a portal are in GetLanePortalTarget
+		// Traffic is added like in CreateFlowField, so the fields can be refreshed every frame
+		void CreateMultiGoalFlowFields(const float* pLaneCosts, const std::vector<int>& goalIndices, std::vector<std::vector<Vector2>>& flowFields, bool applyTraffic = false, float trafficPerAgentMul = 1.f);
+
+		// Size classes: agents of a class only enter cells whose clearance fits their radius, at most MAX_GOALS classes
+		void SetSizeClasses(const std::vector<float>& agentRadii);
+		int GetNrOfSizeClasses() const { return int(m_SizeClassRadii.size()); }
+		const std::vector<float>& GetSizeClassRadii() const { return m_SizeClassRadii; }
+		// Smallest class the agent fits in, the largest class for agents bigger than all of them
+		int GetSizeClass(float agentRadius) const;
+		// All classes share one sweep, a lane per class laid out like the multi goal costs
+		// Flow fields come from CreateMultiGoalFlowFields with the destination as the goal of every class
+		void CalculateSizeClassCellCosts(T_NodeType* pDestinationNode, std::vector<float>& laneCosts);
+		// Same as LoadCellCosts for lanes integrated earlier with the same size classes
+		void LoadSizeClassCellCosts(const float* pCachedLaneCosts, T_NodeType* pDestinationNode);
+
+		// Heap A* over the same step costs and portal links as CalculateCellCosts, for single units and small groups
+		// path gets the cells from start to destination, a portal link shows up as two cells that aren't neighbours
+		// The path is a cheapest one when the heuristic doesn't overestimate on the grid's connectivity (Octile, Euclidean, Chebyshev; Manhattan only on 4-connected grids)
+		bool FindPath(int startIdx, int destinationIdx, std::vector<int>& path);
+		// Same search with a heuristic between two cells, e.g. LandmarkTable::GetHeuristicCost, that never overestimates even across portal links
+		template<class T_CellHeuristic>
+		bool FindPath(int startIdx, int destinationIdx, std::vector<int>& path, const T_CellHeuristic& heuristic);
+		// Flow field that only covers the given paths, every path cell points to the next one and the other cells get no direction
+		// Portal targets follow the links the paths take
+		void CreatePathFlowField(const std::vector<std::vector<int>>& paths, std::vector<Vector2>& flowField);
+		// A* per distinct start cell or one flow field for all of them, whichever is estimated to expand fewer cells
+		PathMethod ChoosePathMethod(const std::vector<int>& startCells, int destinationIdx, const PathMethodCosts& costs = PathMethodCosts()) const;
+
+		// Cell an agent on cellIdx should take a portal to, invalid_node_index when walking is cheaper
+		int GetPortalTarget(int cellIdx) const { return m_PortalTargets[cellIdx]; }
+		// Same for a lane of the last multi goal or size class costs
+		int GetLanePortalTarget(int cellIdx, int lane) const;
+
+		const FlowFieldStats& GetStats() const { return m_Stats; }
+		// Changes whenever cell costs are recalculated, a flow direction changed or the grid's speed field changed
+		unsigned int GetVersion() const { return m_Version + m_pGraph->GetSpeedFieldVersion(); }
+
+		// Traffic follows agents entering and leaving cells instead of being rebuilt every frame
+		void AddAgentTraffic(int cellIdx, float agentRadius);
+		void RemoveAgentTraffic(int cellIdx, float agentRadius);
+
+		// Looks up the cell, speed factor and flow direction of every position in one pass
+		void SampleFlowField(const std::vector<Vector2>& positions, const std::vector<Vector2>& flowField, FlowSamples& samples) const;
+		// Movement multiplier of the cell's terrain, see GridGraph::SetTerrainSpeed
+		float GetSpeedFactor(int cellIdx) const { return m_pGraph->GetSpeedMultiplier(cellIdx); }
 
 	private:
-		float GetHeuristicCost(T_NodeType* pStartNode, T_NodeType* pEndNode) const;
+		// In the grid's cost units, never more than the cheapest way to cover the distance on the grid's connectivity
+		float GetHeuristicCost(int fromIdx, int toIdx) const;
+		// Fast path of CalculateCellCosts for grids where every passable cell has the same cost, see the definition
+		bool CalculateUniformCellCosts(int destinationIdx, std::vector<float>& cellCosts);
+		// Relaxes interleaved lane costs until nothing changes, lanes only enter cells with their required clearance when given
+		void SweepLaneCosts(std::vector<float>& laneCosts, const float* pRequiredClearances);
+		// A cell takes a portal when a link explains its cost and walking does not
+		void ResolvePortalTargets(const float* pCellCosts, int destinationIdx);
+		void ResolveLanePortalTargets(const float* pLaneCosts, const std::vector<int>& goalIndices);
+		// Cost of cell i is pCosts[i * stride], invalid_node_index when the cell walks
+		int FindPortalTarget(int idx, const float* pCosts, int stride) const;
 
-		GridGraph<T_NodeType, T_ConnectionType>* m_pGraph;
+		GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>* m_pGraph;
 		std::vector<float> m_Traffic;
-		Heuristic m_HeuristicFunction;
+		std::vector<float> m_CellAgentRadii; // summed radius of the agents in each cell
+		std::vector<int> m_CellAgentCounts;
+		std::vector<int> m_PortalTargets; // set when the cell's cost came through a portal link
+		std::unordered_map<int, std::array<int, MAX_GOALS>> m_LanePortalTargets; // only cells where a lane takes a portal
+		std::unique_ptr<EWorkerPool> m_pWorkers;
+		std::unique_ptr<std::atomic<float>[]> m_AtomicCosts;
+		std::vector<std::vector<int>> m_ImprovedCells; // per worker
+		std::vector<int> m_CellPhases; // last phase a cell was queued in, filters duplicates
+		//FindPath uses m_AtomicCosts and m_CellPhases as its cost and stamp per cell, stamps count down from -2
+		struct SearchRecord
+		{
+			int cellIdx;
+			float costSoFar;
+			float estimatedTotalCost;
+		};
+		std::vector<int> m_SearchParents;
+		std::vector<SearchRecord> m_SearchHeap;
+		int m_SearchStamp = -1;
+		//bit per cell, rows padded to whole words
+		std::vector<uint64_t> m_PassableBits;
+		std::vector<uint64_t> m_VisitedBits;
+		std::vector<uint64_t> m_LevelBits; // ring of pending cost levels
+		std::vector<std::vector<int>> m_LevelWords; // per ring slot, the words of m_LevelBits that hold bits
+		std::vector<float> m_SizeClassRadii; // ascending
+		float m_RequiredClearances[MAX_GOALS] = {};
+		T_Heuristic m_HeuristicFunction;
+		FlowFieldStats m_Stats;
+		int m_PendingTrafficStamps = 0; // traffic events since the last CreateFlowField
+		int m_PendingAgentsChangedCell = 0;
+		unsigned int m_Version = 0;
 	};
 
-	template <class T_NodeType, class T_ConnectionType>
-	FlowField<T_NodeType, T_ConnectionType>::FlowField(GridGraph<T_NodeType, T_ConnectionType>* pGraph, Heuristic hFunction)
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel, class T_Heuristic>
+	FlowField<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel, T_Heuristic>::FlowField(GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>* pGraph, T_Heuristic heuristic)
 		: m_pGraph(pGraph)
-		, m_HeuristicFunction(hFunction)
+		, m_HeuristicFunction(heuristic)
 	{
 		m_Traffic.resize(m_pGraph->GetNrOfNodes());
+		m_CellAgentRadii.resize(m_pGraph->GetNrOfNodes());
+		m_CellAgentCounts.resize(m_pGraph->GetNrOfNodes());
+		m_PortalTargets.resize(m_pGraph->GetNrOfNodes(), invalid_node_index);
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline void FlowField<T_NodeType, T_ConnectionType>::CalculateCellCosts(T_NodeType* pDestinationNode, std::vector<float>& cellCosts, TeleporterPair* teleporterPair)
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel, class T_Heuristic>
+	void FlowField<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel, T_Heuristic>::AddAgentTraffic(int cellIdx, float agentRadius)
 	{
-		if (teleporterPair)
+		m_CellAgentRadii[cellIdx] += agentRadius;
+		++m_CellAgentCounts[cellIdx];
+		++m_PendingTrafficStamps;
+		++m_PendingAgentsChangedCell;
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel, class T_Heuristic>
+	void FlowField<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel, T_Heuristic>::RemoveAgentTraffic(int cellIdx, float agentRadius)
+	{
+		//reset on the last agent so float errors don't pile up
+		if (--m_CellAgentCounts[cellIdx] <= 0)
+		{
+			m_CellAgentCounts[cellIdx] = 0;
+			m_CellAgentRadii[cellIdx] = 0.f;
+		}
+		else
 		{
-			teleporterPair->Closest = -1;
+			m_CellAgentRadii[cellIdx] -= agentRadius;
 		}
+		++m_PendingTrafficStamps;
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel, class T_Heuristic>
+	void FlowField<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel, T_Heuristic>::SampleFlowField(const std::vector<Vector2>& positions, const std::vector<Vector2>& flowField, FlowSamples& samples) const
+	{
+		samples.Cells.resize(positions.size());
+		samples.SpeedFactors.resize(positions.size());
+		samples.Directions.resize(positions.size());
+		if (positions.empty())
+			return;
+
+		m_pGraph->GetNodesFromWorldPos(positions.data(), positions.size(), samples.Cells.data());
+
+		//gather, speed multipliers come straight from the grid's contiguous speed field
+		const std::vector<float>& speedField = m_pGraph->GetSpeedField();
+		for (size_t i = 0; i < positions.size(); ++i)
+		{
+			const int cell = samples.Cells[i];
+			samples.SpeedFactors[i] = speedField[cell];
+			samples.Directions[i] = flowField[cell];
+		}
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel, class T_Heuristic>
+	inline void FlowField<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel, T_Heuristic>::CalculateCellCosts(T_NodeType* pDestinationNode, std::vector<float>& cellCosts)
+	{
+		ELITE_PROFILE_SCOPE("CalculateCellCosts");
+		++m_Version;
+		m_Stats.NodesPopped = 0;
+		m_Stats.EdgesRelaxed = 0;
+		m_Stats.OpenListPeak = 0;
+		m_Stats.BfsLevels = 0;
+
 		for ( float& cost : cellCosts )
 		{
 			cost = FLT_MAX;
 		}
 		NodeRecord startRecord;
-		startRecord.pNode = pDestinationNode;
+		startRecord.nodeIdx = pDestinationNode->GetIndex();
 		startRecord.costSoFar = 0;
+		//binary min heap on costSoFar
 		std::vector<NodeRecord> openList;
-		std::list<T_NodeType*> closedList;
+		auto isWorse = [](const NodeRecord& a, const NodeRecord& b) { return b < a; };
 		
+		//cellCosts doubles as the closed list, a cell is only (re)opened when a cheaper cost is found for it
 		openList.push_back(startRecord);
-		closedList.push_back(startRecord.pNode);
+		cellCosts[startRecord.nodeIdx] = startRecord.costSoFar;
+		if (!m_pGraph->IsPassable(startRecord.nodeIdx))
+		{
+			return; //nothing can reach an impassable destination
+		}
+		if (CalculateUniformCellCosts(startRecord.nodeIdx, cellCosts))
+		{
+			ResolvePortalTargets(cellCosts.data(), startRecord.nodeIdx);
+			return;
+		}
 		while (!openList.empty())
 		{
-			auto smallestRecordIt = std::min_element(openList.begin(), openList.end());
-			NodeRecord currentRecord = *smallestRecordIt;
-			openList[smallestRecordIt - openList.begin()] = openList.back();
+			m_Stats.OpenListPeak = std::max(m_Stats.OpenListPeak, int(openList.size()));
+			++m_Stats.NodesPopped;
+			std::pop_heap(openList.begin(), openList.end(), isWorse);
+			NodeRecord currentRecord = openList.back();
 			openList.pop_back();
-			cellCosts[currentRecord.pNode->GetIndex()] = currentRecord.costSoFar;
-			if (teleporterPair && teleporterPair->Closest == -1)
+			if (currentRecord.costSoFar > cellCosts[currentRecord.nodeIdx])
+			{
+				continue; //outdated record, the cell was reopened with a lower cost
+			}
+			//portal links are extra edges, walked backwards from the cell they lead to
+			const int currentIdx = currentRecord.nodeIdx;
+			if (m_pGraph->HasIncomingPortalLinks(currentIdx))
 			{
-				if (teleporterPair->PositionIndices.first == currentRecord.pNode->GetIndex())
+				for (const PortalLink& link : m_pGraph->GetIncomingPortalLinks(currentIdx))
 				{
-					NodeRecord teleporterRecord;
-					teleporterRecord.pNode = m_pGraph->GetNode(teleporterPair->PositionIndices.second);
-					teleporterRecord.costSoFar = currentRecord.costSoFar;
-					teleporterPair->Closest = 1;
-					openList.push_back(teleporterRecord);
-					closedList.push_back(teleporterRecord.pNode);
+					NodeRecord portalRecord;
+					portalRecord.nodeIdx = link.CellIdx;
+					portalRecord.costSoFar = currentRecord.costSoFar + link.Cost;
+
+					if (portalRecord.costSoFar < cellCosts[link.CellIdx] && m_pGraph->IsPassable(link.CellIdx))
+					{
+						cellCosts[link.CellIdx] = portalRecord.costSoFar;
+						openList.push_back(portalRecord);
+						std::push_heap(openList.begin(), openList.end(), isWorse);
+						++m_Stats.EdgesRelaxed;
+					}
 				}
-				if (teleporterPair->PositionIndices.second == currentRecord.pNode->GetIndex())
+			}
+
+			//neighbours and step costs come straight from the grid's cost field
+			m_pGraph->ForEachNeighbour(currentIdx, [this, &currentRecord, &openList, &cellCosts, &isWorse](int neighbourIdx, float stepCost)
+				{
+					NodeRecord newRecord;
+					newRecord.nodeIdx = neighbourIdx;
+					newRecord.costSoFar = currentRecord.costSoFar + stepCost;
+
+					if (newRecord.costSoFar < cellCosts[neighbourIdx])
+					{
+						cellCosts[neighbourIdx] = newRecord.costSoFar;
+						openList.push_back(newRecord);
+						std::push_heap(openList.begin(), openList.end(), isWorse);
+						++m_Stats.EdgesRelaxed;
+					}
+				});
+		}
+		ResolvePortalTargets(cellCosts.data(), pDestinationNode->GetIndex());
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel, class T_Heuristic>
+	inline void FlowField<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel, T_Heuristic>::LoadCellCosts(const float* pCachedCosts, T_NodeType* pDestinationNode)
+	{
+		ELITE_PROFILE_SCOPE("LoadCellCosts");
+		++m_Version;
+		m_Stats.NodesPopped = 0;
+		m_Stats.EdgesRelaxed = 0;
+		m_Stats.OpenListPeak = 0;
+		m_Stats.BfsLevels = 0;
+
+		ResolvePortalTargets(pCachedCosts, pDestinationNode->GetIndex());
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel, class T_Heuristic>
+	inline void FlowField<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel, T_Heuristic>::CalculateCellCostsParallel(T_NodeType* pDestinationNode, std::vector<float>& cellCosts, int nrOfThreads, float delta)
+	{
+		ELITE_PROFILE_SCOPE("CalculateCellCostsParallel");
+		++m_Version;
+		m_Stats.NodesPopped = 0;
+		m_Stats.EdgesRelaxed = 0;
+		m_Stats.OpenListPeak = 0;
+
+		if (!m_pWorkers || (nrOfThreads > 0 && m_pWorkers->GetNrOfThreads() != nrOfThreads))
+		{
+			m_pWorkers = std::make_unique<EWorkerPool>(nrOfThreads);
+			m_ImprovedCells.resize(m_pWorkers->GetNrOfThreads());
+		}
+		const int nrOfNodes = m_pGraph->GetNrOfNodes();
+		if (!m_AtomicCosts || int(m_CellPhases.size()) != nrOfNodes)
+		{
+			m_AtomicCosts = std::make_unique<std::atomic<float>[]>(nrOfNodes);
+			m_CellPhases.resize(nrOfNodes);
+		}
+		for (int i = 0; i < nrOfNodes; ++i)
+		{
+			m_AtomicCosts[i].store(FLT_MAX, std::memory_order_relaxed);
+		}
+		std::fill(m_CellPhases.begin(), m_CellPhases.end(), -1);
+
+		const int destinationIdx = pDestinationNode->GetIndex();
+		m_AtomicCosts[destinationIdx].store(0.f, std::memory_order_relaxed);
+		auto getBucket = [this, delta](int idx) { return size_t(m_AtomicCosts[idx].load(std::memory_order_relaxed) / delta); };
+
+		//Only the lowest bucket is worked on. Its cells relax their light edges (cost <= delta) in parallel
+		//until no cell lands in the bucket anymore, then the heavy edges of every settled cell are relaxed once.
+		//Relaxations only ever lower a cost through an atomic min, so the result is the same fixed point
+		//CalculateCellCosts reaches, down to the last bit.
+		std::vector<std::vector<int>> buckets;
+		std::vector<int> frontier;
+		std::vector<int> settled;
+		if (m_pGraph->IsPassable(destinationIdx))
+			buckets.push_back({ destinationIdx });
+
+		auto relaxEdges = [this, delta, &buckets, &getBucket](const std::vector<int>& cells, bool isLight)
+		{
+			m_pWorkers->ParallelFor(int(cells.size()), [this, &cells, delta, isLight](int begin, int end, int threadIdx)
+				{
+					std::vector<int>& improvedCells = m_ImprovedCells[threadIdx];
+					auto relax = [this, &improvedCells, delta, isLight](int toIdx, float costSoFar, float edgeCost)
+					{
+						if ((edgeCost <= delta) != isLight)
+							return;
+
+						const float newCost = costSoFar + edgeCost;
+						float currentCost = m_AtomicCosts[toIdx].load(std::memory_order_relaxed);
+						while (newCost < currentCost)
+						{
+							if (m_AtomicCosts[toIdx].compare_exchange_weak(currentCost, newCost, std::memory_order_relaxed))
+							{
+								improvedCells.push_back(toIdx);
+								break;
+							}
+						}
+					};
+
+					for (int i = begin; i < end; ++i)
+					{
+						const int idx = cells[i];
+						const float costSoFar = m_AtomicCosts[idx].load(std::memory_order_relaxed);
+						m_pGraph->ForEachNeighbour(idx, [&relax, costSoFar](int neighbourIdx, float stepCost) { relax(neighbourIdx, costSoFar, stepCost); });
+						if (m_pGraph->HasIncomingPortalLinks(idx))
+						{
+							for (const PortalLink& link : m_pGraph->GetIncomingPortalLinks(idx))
+							{
+								if (m_pGraph->IsPassable(link.CellIdx))
+									relax(link.CellIdx, costSoFar, link.Cost);
+							}
+						}
+					}
+				}, 64);
+
+			//merging on the calling thread keeps the buckets free of locks
+			for (std::vector<int>& improvedCells : m_ImprovedCells)
+			{
+				m_Stats.EdgesRelaxed += int(improvedCells.size());
+				for (int idx : improvedCells)
 				{
-					NodeRecord teleporterRecord;
-					teleporterRecord.pNode = m_pGraph->GetNode(teleporterPair->PositionIndices.first);
-					teleporterRecord.costSoFar = currentRecord.costSoFar;
-					teleporterPair->Closest = 2;
-					openList.push_back(teleporterRecord);
-					closedList.push_back(teleporterRecord.pNode);
+					const size_t bucket = getBucket(idx);
+					if (bucket >= buckets.size())
+						buckets.resize(bucket + 1);
+					buckets[bucket].push_back(idx);
 				}
+				improvedCells.clear();
 			}
-			
+		};
 
-			for (T_ConnectionType* con : m_pGraph->GetNodeConnections(currentRecord.pNode->GetIndex()))
+		int phase = 0;
+		for (size_t bucket = 0; bucket < buckets.size(); ++bucket)
+		{
+			//heavy edges can still round back into this bucket, so it is only done once it stays empty
+			while (!buckets[bucket].empty())
 			{
-				NodeRecord newRecord;
-				newRecord.pNode = m_pGraph->GetNode(con->GetTo());
-				newRecord.costSoFar = currentRecord.costSoFar + con->GetCost();
+				settled.clear();
+				while (!buckets[bucket].empty())
+				{
+					//drop cells that moved to a lower bucket or are queued twice
+					frontier.clear();
+					for (int idx : buckets[bucket])
+					{
+						if (getBucket(idx) == bucket && m_CellPhases[idx] != phase)
+						{
+							m_CellPhases[idx] = phase;
+							frontier.push_back(idx);
+						}
+					}
+					buckets[bucket].clear();
+					++phase;
 
-				if (std::find(closedList.begin(), closedList.end(), newRecord.pNode) == closedList.end())
+					m_Stats.NodesPopped += int(frontier.size());
+					m_Stats.OpenListPeak = std::max(m_Stats.OpenListPeak, int(frontier.size()));
+					settled.insert(settled.end(), frontier.begin(), frontier.end());
+					relaxEdges(frontier, true);
+				}
+
+				//a cell can be settled more than once per bucket, its heavy edges only need the final cost
+				frontier.clear();
+				for (int idx : settled)
 				{
-					openList.push_back(newRecord);
-					closedList.push_back(newRecord.pNode);
+					if (m_CellPhases[idx] != phase)
+					{
+						m_CellPhases[idx] = phase;
+						frontier.push_back(idx);
+					}
 				}
+				++phase;
+				relaxEdges(frontier, false);
 			}
 		}
+
+		cellCosts.resize(nrOfNodes);
+		for (int i = 0; i < nrOfNodes; ++i)
+		{
+			cellCosts[i] = m_AtomicCosts[i].load(std::memory_order_relaxed);
+		}
+		ResolvePortalTargets(cellCosts.data(), destinationIdx);
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline void FlowField<T_NodeType, T_ConnectionType>::CreateFlowField(const std::vector<float>& cellCosts, std::vector<Vector2>& flowField, const T_NodeType* endNode, const std::vector<SteeringAgent*>* pAgents, float trafficPerAgentMul)
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel, class T_Heuristic>
+	inline bool FlowField<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel, T_Heuristic>::CalculateUniformCellCosts(int destinationIdx, std::vector<float>& cellCosts)
 	{
-		const std::vector<float>* finalCosts;
-		if (pAgents)
+		//Every passable cell costs the same, so all step costs are multiples of one unit (0.5 for the default 1 / 1.5 steps)
+		//and the integration is a flood of the passability bitset, one cost level at a time.
+		//64 cells are expanded per word: shifts within a row for east/west, whole rows for north/south.
+		//Costs are level * unit, which is what the weighted integrator sums to while the costs stay exact floats,
+		//so only a power of two unit is taken: any other unit (0.2) rounds differently in the sums than in the product.
+		const unsigned char* costField = m_pGraph->GetCostField();
+		const int nrOfNodes = m_pGraph->GetNrOfNodes();
+		int uniformCost = T_CostModel::UsesCostField ? -1 : 1;
+		for (int idx = 0; T_CostModel::UsesCostField && idx < nrOfNodes; ++idx)
 		{
-			for (size_t i = 0; i < m_Traffic.size(); i++)
+			const unsigned char cost = costField[idx];
+			if (cost == impassable_cell_cost || cost == uniformCost)
+				continue;
+			if (uniformCost != -1)
+				return false; //mud or other weighted cells
+			uniformCost = cost;
+		}
+		if (uniformCost <= 0)
+			return false;
+
+		const unsigned char cost = static_cast<unsigned char>(uniformCost);
+		const float straightCost = T_CostModel::GetStepCost(m_pGraph->GetDefaultCostStraight(), cost, cost);
+		const float diagonalCost = T_CostModel::GetStepCost(m_pGraph->GetDefaultCostDiagonal(), cost, cost);
+		const bool isDiagonal = m_pGraph->IsConnectedDiagonally();
+		const int maxUnitsPerStep = 64;
+		auto toUnits = [](float cost, float unit)
+		{
+			const float units = cost / unit;
+			return units >= 0.f && units <= maxUnitsPerStep && units == floorf(units) && units * unit == cost ? int(units) : -1;
+		};
+
+		float unit = 0.f;
+		int straightUnits = -1;
+		int diagonalUnits = 0;
+		for (int divisor = 1; divisor <= 8 && straightUnits == -1; ++divisor)
+		{
+			const float candidateUnit = straightCost / divisor;
+			int exponent;
+			if (frexpf(candidateUnit, &exponent) != 0.5f)
+				continue;
+			if (toUnits(straightCost, candidateUnit) == divisor && (!isDiagonal || toUnits(diagonalCost, candidateUnit) > 0))
 			{
-				m_Traffic[i] = 0.f; //reset
+				unit = candidateUnit;
+				straightUnits = divisor;
+				diagonalUnits = isDiagonal ? toUnits(diagonalCost, candidateUnit) : 0;
+			}
+		}
+		if (straightUnits == -1)
+			return false;
+
+		//portal links become extra jumps of a whole number of units
+		int maxUnits = std::max(straightUnits, diagonalUnits);
+		std::vector<int> portalExits; // cells with incoming links
+		for (const auto& portalLinks : m_pGraph->GetAllPortalLinks())
+		{
+			for (const PortalLink& link : portalLinks.second)
+			{
+				const int linkUnits = toUnits(link.Cost, unit);
+				if (linkUnits < 0)
+					return false;
+				maxUnits = std::max(maxUnits, linkUnits);
+				if (m_pGraph->HasIncomingPortalLinks(link.CellIdx) && std::find(portalExits.begin(), portalExits.end(), link.CellIdx) == portalExits.end())
+					portalExits.push_back(link.CellIdx);
+			}
+		}
+
+		const int nrOfColumns = m_pGraph->GetColumns();
+		const int nrOfRows = m_pGraph->GetRows();
+		const int wordsPerRow = (nrOfColumns + 63) / 64;
+		const int nrOfWords = wordsPerRow * nrOfRows;
+		const int ringSize = maxUnits + 1;
+		m_PassableBits.assign(nrOfWords, 0);
+		m_VisitedBits.assign(nrOfWords, 0);
+		m_LevelBits.assign(size_t(nrOfWords) * ringSize, 0);
+		m_LevelWords.resize(ringSize);
+		for (std::vector<int>& levelWords : m_LevelWords)
+		{
+			levelWords.clear();
+		}
+
+		//the bit rows are always row major, whatever the layout of the graph
+		auto getBitPos = [&](int idx, int& word, int& bit)
+		{
+			int col, row;
+			m_pGraph->GetColRow(idx, col, row);
+			word = row * wordsPerRow + col / 64;
+			bit = col % 64;
+		};
+		for (int idx = 0; idx < nrOfNodes; ++idx)
+		{
+			int word, bit;
+			getBitPos(idx, word, bit);
+			if (costField[idx] != impassable_cell_cost)
+				m_PassableBits[word] |= uint64_t(1) << bit;
+		}
+
+		auto getBit = [&](const std::vector<uint64_t>& bits, int slot, int idx)
+		{
+			int word, bit;
+			getBitPos(idx, word, bit);
+			return (bits[size_t(slot) * nrOfWords + word] >> bit) & 1;
+		};
+		//only the words a level touches are listed, so a level costs its frontier and not the rows it spans
+		int lastLevel = 0;
+		auto addToLevel = [&](int level, int word, uint64_t bits)
+		{
+			bits &= m_PassableBits[word] & ~m_VisitedBits[word];
+			if (bits == 0)
+				return;
+			const int slot = level % ringSize;
+			uint64_t& levelWord = m_LevelBits[size_t(slot) * nrOfWords + word];
+			if (levelWord == 0)
+				m_LevelWords[slot].push_back(word);
+			levelWord |= bits;
+			lastLevel = std::max(lastLevel, level);
+		};
+		//east and west of the bits come from shifts, the bits that leave the word go to its neighbours
+		auto addSidewaysToLevel = [&](int level, int row, int column, uint64_t bits)
+		{
+			if (row < 0 || row >= nrOfRows)
+				return;
+			const int word = row * wordsPerRow + column;
+			addToLevel(level, word, (bits << 1) | (bits >> 1));
+			if (column > 0)
+				addToLevel(level, word - 1, bits << 63);
+			if (column + 1 < wordsPerRow)
+				addToLevel(level, word + 1, bits >> 63);
+		};
+		auto addCell = [&](int level, int idx)
+		{
+			int word, bit;
+			getBitPos(idx, word, bit);
+			addToLevel(level, word, uint64_t(1) << bit);
+		};
+
+		addCell(0, destinationIdx);
+		for (int level = 0; level <= lastLevel; ++level)
+		{
+			const int slot = level % ringSize;
+			uint64_t* pLevel = &m_LevelBits[size_t(slot) * nrOfWords];
+			std::vector<int>& levelWords = m_LevelWords[slot];
+			if (levelWords.empty())
+				continue;
+			++m_Stats.BfsLevels;
+
+			//cells reached at this level are final
+			for (int w : levelWords)
+			{
+				pLevel[w] &= ~m_VisitedBits[w];
+				m_VisitedBits[w] |= pLevel[w];
+			}
+
+			//free links finalize their other end at the same level
+			bool hasAddedToLevel = !portalExits.empty();
+			while (hasAddedToLevel)
+			{
+				hasAddedToLevel = false;
+				for (int exitIdx : portalExits)
+				{
+					if (!getBit(m_LevelBits, slot, exitIdx))
+						continue;
+					for (const PortalLink& link : m_pGraph->GetIncomingPortalLinks(exitIdx))
+					{
+						if (getBit(m_VisitedBits, 0, link.CellIdx))
+							continue;
+						addCell(level + toUnits(link.Cost, unit), link.CellIdx);
+						if (link.Cost == 0.f && getBit(m_LevelBits, slot, link.CellIdx))
+						{
+							int word, bit;
+							getBitPos(link.CellIdx, word, bit);
+							m_VisitedBits[word] |= uint64_t(1) << bit;
+							hasAddedToLevel = true;
+						}
+					}
+				}
+			}
+
+			//the words free links added above are expanded with the others
+			for (size_t i = 0; i < levelWords.size(); ++i)
+			{
+				const int w = levelWords[i];
+				const uint64_t bits = pLevel[w];
+				pLevel[w] = 0; //the slot is reused by a later level
+				if (bits == 0)
+					continue;
+				const int row = w / wordsPerRow;
+				const int column = w % wordsPerRow;
+
+				uint64_t remaining = bits;
+				while (remaining != 0)
+				{
+#ifdef _MSC_VER
+					unsigned long bit;
+					_BitScanForward64(&bit, remaining);
+#else
+					const int bit = __builtin_ctzll(remaining);
+#endif
+					cellCosts[m_pGraph->GetIndex(column * 64 + int(bit), row)] = level * unit;
+					++m_Stats.NodesPopped;
+					remaining &= remaining - 1;
+				}
+
+				addSidewaysToLevel(level + straightUnits, row, column, bits);
+				if (row > 0)
+					addToLevel(level + straightUnits, w - wordsPerRow, bits);
+				if (row + 1 < nrOfRows)
+					addToLevel(level + straightUnits, w + wordsPerRow, bits);
+				if (isDiagonal)
+				{
+					addSidewaysToLevel(level + diagonalUnits, row - 1, column, bits);
+					addSidewaysToLevel(level + diagonalUnits, row + 1, column, bits);
+				}
 			}
-			for (size_t i = 0; i < pAgents->size(); i++) //adding a small cost too each cell per agent
+			levelWords.clear();
+		}
+		return true;
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel, class T_Heuristic>
+	inline void FlowField<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel, T_Heuristic>::ResolvePortalTargets(const float* pCellCosts, int destinationIdx)
+	{
+		std::fill(m_PortalTargets.begin(), m_PortalTargets.end(), int(invalid_node_index));
+		for (const auto& portalLinks : m_pGraph->GetAllPortalLinks())
+		{
+			if (portalLinks.first != destinationIdx)
+				m_PortalTargets[portalLinks.first] = FindPortalTarget(portalLinks.first, pCellCosts, 1);
+		}
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel, class T_Heuristic>
+	inline void FlowField<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel, T_Heuristic>::ResolveLanePortalTargets(const float* pLaneCosts, const std::vector<int>& goalIndices)
+	{
+		m_LanePortalTargets.clear();
+		for (const auto& portalLinks : m_pGraph->GetAllPortalLinks())
+		{
+			const int idx = portalLinks.first;
+			std::array<int, MAX_GOALS> targets;
+			targets.fill(invalid_node_index);
+			bool hasTarget = false;
+			for (size_t lane = 0; lane < goalIndices.size(); ++lane)
 			{
-				m_Traffic[m_pGraph->GetNodeFromWorldPos((*pAgents)[i]->GetPosition())] += trafficPerAgentMul * (*pAgents)[i]->GetRadius() / m_pGraph->GetCellSize(); //taffic from each agent is bigger if the cellsize is smaller and the agent radius is bigger
-				DEBUGRENDERER2D->DrawSolidCircle(m_pGraph->GetNodeWorldPos(m_pGraph->GetNodeFromWorldPos((*pAgents)[i]->GetPosition())), m_pGraph->GetCellSize() / 2, {0.f,0.f}, { 0.7f, 0.f, 0.f });
+				if (idx == goalIndices[lane])
+					continue;
+				targets[lane] = FindPortalTarget(idx, pLaneCosts + lane, MAX_GOALS);
+				hasTarget |= targets[lane] != invalid_node_index;
 			}
-			for (size_t i = 0; i < m_Traffic.size(); i++)
+			if (hasTarget)
+				m_LanePortalTargets[idx] = targets;
+		}
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel, class T_Heuristic>
+	inline int FlowField<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel, T_Heuristic>::GetLanePortalTarget(int cellIdx, int lane) const
+	{
+		auto it = m_LanePortalTargets.find(cellIdx);
+		return it == m_LanePortalTargets.end() ? int(invalid_node_index) : it->second[lane];
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel, class T_Heuristic>
+	inline int FlowField<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel, T_Heuristic>::FindPortalTarget(int idx, const float* pCosts, int stride) const
+	{
+		const float cost = pCosts[idx * stride];
+		if (cost == FLT_MAX || !m_pGraph->IsPassable(idx))
+			return invalid_node_index;
+
+		//on a tie walking wins, so both ends of a free link never send agents back and forth
+		bool isReachedByWalking = false;
+		m_pGraph->ForEachNeighbour(idx, [pCosts, stride, cost, &isReachedByWalking](int neighbourIdx, float stepCost)
 			{
-				m_Traffic[i] += cellCosts[i]; //adding the cellCosts
+				if (pCosts[neighbourIdx * stride] + stepCost == cost)
+					isReachedByWalking = true;
+			});
+		if (isReachedByWalking)
+			return invalid_node_index;
+
+		for (const PortalLink& link : m_pGraph->GetPortalLinks(idx))
+		{
+			if (m_pGraph->IsPassable(link.CellIdx) && pCosts[link.CellIdx * stride] + link.Cost == cost)
+				return link.CellIdx;
+		}
+		return invalid_node_index;
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel, class T_Heuristic>
+	inline void FlowField<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel, T_Heuristic>::CreateFlowField(const float* pCellCosts, std::vector<Vector2>& flowField, const T_NodeType* endNode, bool applyTraffic, float trafficPerAgentMul)
+	{
+		ELITE_PROFILE_SCOPE("CreateFlowField");
+		m_Stats.DirectionsChanged = 0;
+		m_Stats.TrafficStamps = m_PendingTrafficStamps;
+		m_Stats.AgentsChangedCell = m_PendingAgentsChangedCell;
+		m_PendingTrafficStamps = 0;
+		m_PendingAgentsChangedCell = 0;
+
+		const float* pFinalCosts;
+		if (applyTraffic)
+		{
+			for (size_t i = 0; i < m_Traffic.size(); i++) //adding a small cost too each cell per agent
+			{
+				m_Traffic[i] = pCellCosts[i] + trafficPerAgentMul * m_CellAgentRadii[i] / m_pGraph->GetCellSize(); //taffic from each agent is bigger if the cellsize is smaller and the agent radius is bigger
 			}
-			finalCosts = &m_Traffic;
+			pFinalCosts = m_Traffic.data();
 		}
 		else
-			finalCosts = &cellCosts;
+			pFinalCosts = pCellCosts;
 
-		for (size_t i = 0; i < flowField.size(); i++)
+		const int nrOfNodes = m_pGraph->GetNrOfNodes();
+		for (int idx = 0; idx < nrOfNodes; ++idx)
 		{
-			flowField[i] = ZeroVector2;
+			//cells without a cheaper neighbour keep a zero direction
+			Vector2 direction = ZeroVector2;
+			if (m_pGraph->IsPassable(idx) && idx != endNode->GetIndex())
+			{
+				int cheapestNeighbourIdx = invalid_node_index;
+				m_pGraph->ForEachNeighbour(idx, [pFinalCosts, &cheapestNeighbourIdx](int neighbourIdx, float)
+					{
+						if (cheapestNeighbourIdx == invalid_node_index || pFinalCosts[neighbourIdx] < pFinalCosts[cheapestNeighbourIdx])
+							cheapestNeighbourIdx = neighbourIdx;
+					});
+				if (cheapestNeighbourIdx != invalid_node_index)
+					direction = (m_pGraph->GetNodePos(cheapestNeighbourIdx) - m_pGraph->GetNodePos(idx)).GetNormalized();
+			}
+
+			if (flowField[idx] != direction)
+			{
+				flowField[idx] = direction;
+				++m_Stats.DirectionsChanged;
+			}
 		}
-		for (auto node : m_pGraph->GetAllNodes() )
+		if (m_Stats.DirectionsChanged > 0)
+			++m_Version;
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel, class T_Heuristic>
+	inline void FlowField<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel, T_Heuristic>::CalculateMultiGoalCellCosts(const std::vector<int>& goalIndices, std::vector<float>& laneCosts)
+	{
+		ELITE_PROFILE_SCOPE("CalculateMultiGoalCellCosts");
+		assert(goalIndices.size() <= MAX_GOALS && "<FlowField::CalculateMultiGoalCellCosts>: too many goals");
+		m_Stats.SweepPasses = 0;
+
+		const int nrOfNodes = m_pGraph->GetNrOfNodes();
+		laneCosts.assign(size_t(nrOfNodes) * MAX_GOALS, FLT_MAX);
+		for (size_t goal = 0; goal < goalIndices.size(); ++goal)
 		{
-			auto connections = m_pGraph->GetNodeConnections(node->GetIndex());
-			auto cheapestConnectionIt = std::min_element(connections.begin(), connections.end(), [&finalCosts](const T_ConnectionType* lh, const T_ConnectionType* rh) {
-				return (*finalCosts)[lh->GetTo()] < (*finalCosts)[rh->GetTo()];
-				});
-			if (cheapestConnectionIt == connections.end() || node->GetIndex() == endNode->GetIndex())
+			laneCosts[goalIndices[goal] * MAX_GOALS + goal] = 0.f;
+		}
+		SweepLaneCosts(laneCosts, nullptr);
+		ResolveLanePortalTargets(laneCosts.data(), goalIndices);
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel, class T_Heuristic>
+	inline void FlowField<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel, T_Heuristic>::SetSizeClasses(const std::vector<float>& agentRadii)
+	{
+		assert(agentRadii.size() <= MAX_GOALS && "<FlowField::SetSizeClasses>: too many size classes");
+		m_SizeClassRadii = agentRadii;
+		std::sort(m_SizeClassRadii.begin(), m_SizeClassRadii.end());
+		std::fill(m_RequiredClearances, m_RequiredClearances + MAX_GOALS, 0.f);
+		for (size_t sizeClass = 0; sizeClass < m_SizeClassRadii.size(); ++sizeClass)
+		{
+			//clearance runs between cell centers, the obstacle cell's edge is half a cell closer
+			m_RequiredClearances[sizeClass] = m_SizeClassRadii[sizeClass] / m_pGraph->GetCellSize() + 0.5f;
+		}
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel, class T_Heuristic>
+	inline int FlowField<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel, T_Heuristic>::GetSizeClass(float agentRadius) const
+	{
+		auto it = std::lower_bound(m_SizeClassRadii.begin(), m_SizeClassRadii.end(), agentRadius);
+		if (it == m_SizeClassRadii.end())
+			return int(m_SizeClassRadii.size()) - 1;
+		return int(it - m_SizeClassRadii.begin());
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel, class T_Heuristic>
+	inline void FlowField<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel, T_Heuristic>::CalculateSizeClassCellCosts(T_NodeType* pDestinationNode, std::vector<float>& laneCosts)
+	{
+		ELITE_PROFILE_SCOPE("CalculateSizeClassCellCosts");
+		m_Stats.SweepPasses = 0;
+		m_pGraph->UpdateClearanceField();
+
+		//every class starts at the destination, even when it is too narrow, so big agents still get as close as they fit
+		laneCosts.assign(size_t(m_pGraph->GetNrOfNodes()) * MAX_GOALS, FLT_MAX);
+		for (size_t sizeClass = 0; sizeClass < m_SizeClassRadii.size(); ++sizeClass)
+		{
+			laneCosts[pDestinationNode->GetIndex() * MAX_GOALS + sizeClass] = 0.f;
+		}
+		SweepLaneCosts(laneCosts, m_RequiredClearances);
+		ResolveLanePortalTargets(laneCosts.data(), std::vector<int>(m_SizeClassRadii.size(), pDestinationNode->GetIndex()));
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel, class T_Heuristic>
+	inline void FlowField<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel, T_Heuristic>::LoadSizeClassCellCosts(const float* pCachedLaneCosts, T_NodeType* pDestinationNode)
+	{
+		ELITE_PROFILE_SCOPE("LoadSizeClassCellCosts");
+		m_Stats.SweepPasses = 0;
+		ResolveLanePortalTargets(pCachedLaneCosts, std::vector<int>(m_SizeClassRadii.size(), pDestinationNode->GetIndex()));
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel, class T_Heuristic>
+	inline void FlowField<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel, T_Heuristic>::SweepLaneCosts(std::vector<float>& laneCosts, const float* pRequiredClearances)
+	{
+		//Sweeping instead of a priority queue, a single open list can't order several goals at once.
+		//Every pass relaxes all cells in place, alternating the direction so costs travel both ways,
+		//until a pass changes nothing. Open maps settle in a handful of passes, mazes need more.
+		const int nrOfNodes = m_pGraph->GetNrOfNodes();
+		float* pCosts = laneCosts.data();
+#ifdef ELITE_GRID_SSE2
+		const __m128 requiredLow = pRequiredClearances ? _mm_loadu_ps(pRequiredClearances) : _mm_setzero_ps();
+		const __m128 requiredHigh = pRequiredClearances ? _mm_loadu_ps(pRequiredClearances + 4) : _mm_setzero_ps();
+#endif
+		bool hasChanged = true;
+		while (hasChanged)
+		{
+			hasChanged = false;
+			const bool isForward = m_Stats.SweepPasses % 2 == 0;
+			++m_Stats.SweepPasses;
+			for (int i = 0; i < nrOfNodes; ++i)
 			{
+				const int idx = isForward ? i : nrOfNodes - 1 - i;
+				if (!m_pGraph->IsPassable(idx))
+					continue;
+
+				float* pCell = pCosts + idx * MAX_GOALS;
+#ifdef ELITE_GRID_SSE2
+				const __m128 oldLow = _mm_loadu_ps(pCell);
+				const __m128 oldHigh = _mm_loadu_ps(pCell + 4);
+				__m128 low = oldLow;
+				__m128 high = oldHigh;
+				auto relax = [pCosts, &low, &high](int otherIdx, float stepCost)
+				{
+					const __m128 step = _mm_set1_ps(stepCost);
+					const float* pOther = pCosts + otherIdx * MAX_GOALS;
+					low = _mm_min_ps(low, _mm_add_ps(_mm_loadu_ps(pOther), step));
+					high = _mm_min_ps(high, _mm_add_ps(_mm_loadu_ps(pOther + 4), step));
+				};
+#else
+				float lanes[MAX_GOALS];
+				std::copy(pCell, pCell + MAX_GOALS, lanes);
+				auto relax = [pCosts, &lanes](int otherIdx, float stepCost)
+				{
+					const float* pOther = pCosts + otherIdx * MAX_GOALS;
+					for (int goal = 0; goal < MAX_GOALS; ++goal)
+						lanes[goal] = std::min(lanes[goal], pOther[goal] + stepCost);
+				};
+#endif
+				m_pGraph->ForEachNeighbour(idx, relax);
+				if (m_pGraph->HasPortalLinks(idx))
+				{
+					for (const PortalLink& link : m_pGraph->GetPortalLinks(idx))
+					{
+						if (m_pGraph->IsPassable(link.CellIdx))
+							relax(link.CellIdx, link.Cost);
+					}
+				}
+
+#ifdef ELITE_GRID_SSE2
+				if (pRequiredClearances)
+				{
+					//lanes that don't fit in this cell keep their cost
+					const __m128 clearance = _mm_set1_ps(m_pGraph->GetClearance(idx));
+					const __m128 fitsLow = _mm_cmpge_ps(clearance, requiredLow);
+					const __m128 fitsHigh = _mm_cmpge_ps(clearance, requiredHigh);
+					low = _mm_or_ps(_mm_and_ps(fitsLow, low), _mm_andnot_ps(fitsLow, oldLow));
+					high = _mm_or_ps(_mm_and_ps(fitsHigh, high), _mm_andnot_ps(fitsHigh, oldHigh));
+				}
+				if (_mm_movemask_ps(_mm_cmplt_ps(low, oldLow)) | _mm_movemask_ps(_mm_cmplt_ps(high, oldHigh)))
+				{
+					_mm_storeu_ps(pCell, low);
+					_mm_storeu_ps(pCell + 4, high);
+					hasChanged = true;
+				}
+#else
+				if (pRequiredClearances)
+				{
+					//lanes that don't fit in this cell keep their cost
+					for (int lane = 0; lane < MAX_GOALS; ++lane)
+					{
+						if (m_pGraph->GetClearance(idx) < pRequiredClearances[lane])
+							lanes[lane] = pCell[lane];
+					}
+				}
+				if (!std::equal(lanes, lanes + MAX_GOALS, pCell))
+				{
+					std::copy(lanes, lanes + MAX_GOALS, pCell);
+					hasChanged = true;
+				}
+#endif
+			}
+		}
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel, class T_Heuristic>
+	inline void FlowField<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel, T_Heuristic>::CreateMultiGoalFlowFields(const float* pLaneCosts, const std::vector<int>& goalIndices, std::vector<std::vector<Vector2>>& flowFields, bool applyTraffic, float trafficPerAgentMul)
+	{
+		ELITE_PROFILE_SCOPE("CreateMultiGoalFlowFields");
+		const int nrOfGoals = int(goalIndices.size());
+		const int nrOfNodes = m_pGraph->GetNrOfNodes();
+		flowFields.resize(nrOfGoals);
+		for (std::vector<Vector2>& flowField : flowFields)
+		{
+			flowField.resize(nrOfNodes, ZeroVector2);
+		}
+		if (nrOfGoals == 0)
+			return;
+		const float trafficPerRadius = applyTraffic ? trafficPerAgentMul / m_pGraph->GetCellSize() : 0.f;
+		bool hasChanged = false;
+
+		//one neighbour walk per cell serves every goal
+		int cheapestNeighbours[MAX_GOALS];
+		for (int idx = 0; idx < nrOfNodes; ++idx)
+		{
+			if (!m_pGraph->IsPassable(idx))
 				continue;
+
+			std::fill(cheapestNeighbours, cheapestNeighbours + nrOfGoals, int(invalid_node_index));
+			float cheapestCosts[MAX_GOALS];
+			m_pGraph->ForEachNeighbour(idx, [this, pLaneCosts, &cheapestNeighbours, &cheapestCosts, nrOfGoals, trafficPerRadius](int neighbourIdx, float)
+				{
+					const float* pNeighbour = pLaneCosts + neighbourIdx * MAX_GOALS;
+					const float traffic = trafficPerRadius * m_CellAgentRadii[neighbourIdx];
+					for (int goal = 0; goal < nrOfGoals; ++goal)
+					{
+						const float cost = pNeighbour[goal] + traffic;
+						if (cheapestNeighbours[goal] == invalid_node_index || cost < cheapestCosts[goal])
+						{
+							cheapestNeighbours[goal] = neighbourIdx;
+							cheapestCosts[goal] = cost;
+						}
+					}
+				});
+
+			for (int goal = 0; goal < nrOfGoals; ++goal)
+			{
+				Vector2 direction = ZeroVector2;
+				if (cheapestNeighbours[goal] != invalid_node_index && idx != goalIndices[goal])
+					direction = (m_pGraph->GetNodePos(cheapestNeighbours[goal]) - m_pGraph->GetNodePos(idx)).GetNormalized();
+				if (flowFields[goal][idx] != direction)
+				{
+					flowFields[goal][idx] = direction;
+					hasChanged = true;
+				}
 			}
-			flowField[node->GetIndex()] = (m_pGraph->GetNodePos((*cheapestConnectionIt)->GetTo()) - m_pGraph->GetNodePos(node)).GetNormalized();
 		}
-		flowField[endNode->GetIndex()] = ZeroVector2;
+		if (hasChanged)
+			++m_Version;
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel, class T_Heuristic>
+	inline bool FlowField<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel, T_Heuristic>::FindPath(int startIdx, int destinationIdx, std::vector<int>& path)
+	{
+		//portal links shortcut any distance, with them the search runs without a heuristic
+		const bool useHeuristic = m_pGraph->GetAllPortalLinks().empty();
+		return FindPath(startIdx, destinationIdx, path, [this, useHeuristic](int fromIdx, int toIdx)
+			{
+				return useHeuristic ? GetHeuristicCost(fromIdx, toIdx) : 0.f;
+			});
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel, class T_Heuristic>
+	template<class T_CellHeuristic>
+	inline bool FlowField<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel, T_Heuristic>::FindPath(int startIdx, int destinationIdx, std::vector<int>& path, const T_CellHeuristic& heuristic)
+	{
+		ELITE_PROFILE_SCOPE("FindPath");
+		m_Stats.NodesPopped = 0;
+		m_Stats.EdgesRelaxed = 0;
+		m_Stats.OpenListPeak = 0;
+		m_Stats.BfsLevels = 0;
+		path.clear();
+		if (!m_pGraph->IsPassable(startIdx) || !m_pGraph->IsPassable(destinationIdx))
+			return false;
+
+		//shares the per cell buffers of CalculateCellCostsParallel, which resets the stamps to -1 and counts its phases up from 0
+		const int nrOfNodes = m_pGraph->GetNrOfNodes();
+		if (!m_AtomicCosts || int(m_CellPhases.size()) != nrOfNodes)
+		{
+			m_AtomicCosts = std::make_unique<std::atomic<float>[]>(nrOfNodes);
+			m_CellPhases.assign(nrOfNodes, -1);
+		}
+		m_SearchParents.resize(nrOfNodes);
+		if (m_SearchStamp == INT_MIN)
+		{
+			std::fill(m_CellPhases.begin(), m_CellPhases.end(), -1);
+			m_SearchStamp = -1;
+		}
+		const int stamp = --m_SearchStamp;
+
+		//lowest estimate on top, ties go to the record furthest along
+		auto isWorse = [](const SearchRecord& a, const SearchRecord& b)
+		{
+			return a.estimatedTotalCost != b.estimatedTotalCost ? a.estimatedTotalCost > b.estimatedTotalCost : a.costSoFar < b.costSoFar;
+		};
+		auto openCell = [this, stamp, destinationIdx, &heuristic, &isWorse](int idx, int parentIdx, float costSoFar)
+		{
+			m_CellPhases[idx] = stamp;
+			m_AtomicCosts[idx].store(costSoFar, std::memory_order_relaxed);
+			m_SearchParents[idx] = parentIdx;
+			m_SearchHeap.push_back({ idx, costSoFar, costSoFar + heuristic(idx, destinationIdx) });
+			std::push_heap(m_SearchHeap.begin(), m_SearchHeap.end(), isWorse);
+		};
+
+		m_SearchHeap.clear();
+		openCell(startIdx, invalid_node_index, 0.f);
+		while (!m_SearchHeap.empty())
+		{
+			m_Stats.OpenListPeak = std::max(m_Stats.OpenListPeak, int(m_SearchHeap.size()));
+			++m_Stats.NodesPopped;
+			std::pop_heap(m_SearchHeap.begin(), m_SearchHeap.end(), isWorse);
+			const SearchRecord currentRecord = m_SearchHeap.back();
+			m_SearchHeap.pop_back();
+			const int currentIdx = currentRecord.cellIdx;
+			if (currentRecord.costSoFar > m_AtomicCosts[currentIdx].load(std::memory_order_relaxed))
+			{
+				continue; //outdated record, the cell was reopened with a lower cost
+			}
+			if (currentIdx == destinationIdx)
+			{
+				for (int idx = destinationIdx; idx != invalid_node_index; idx = m_SearchParents[idx])
+				{
+					path.push_back(idx);
+				}
+				std::reverse(path.begin(), path.end());
+				return true;
+			}
+
+			auto relax = [this, stamp, &currentRecord, &openCell](int neighbourIdx, float stepCost)
+			{
+				const float costSoFar = currentRecord.costSoFar + stepCost;
+				if (m_CellPhases[neighbourIdx] != stamp || costSoFar < m_AtomicCosts[neighbourIdx].load(std::memory_order_relaxed))
+				{
+					openCell(neighbourIdx, currentRecord.cellIdx, costSoFar);
+					++m_Stats.EdgesRelaxed;
+				}
+			};
+			if (m_pGraph->HasPortalLinks(currentIdx))
+			{
+				for (const PortalLink& link : m_pGraph->GetPortalLinks(currentIdx))
+				{
+					if (m_pGraph->IsPassable(link.CellIdx))
+						relax(link.CellIdx, link.Cost);
+				}
+			}
+			m_pGraph->ForEachNeighbour(currentIdx, relax);
+		}
+		return false;
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel, class T_Heuristic>
+	inline void FlowField<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel, T_Heuristic>::CreatePathFlowField(const std::vector<std::vector<int>>& paths, std::vector<Vector2>& flowField)
+	{
+		ELITE_PROFILE_SCOPE("CreatePathFlowField");
+		++m_Version;
+		std::fill(flowField.begin(), flowField.end(), ZeroVector2);
+		std::fill(m_PortalTargets.begin(), m_PortalTargets.end(), int(invalid_node_index));
+		for (const std::vector<int>& path : paths)
+		{
+			for (size_t i = 0; i + 1 < path.size(); ++i)
+			{
+				const Vector2 toNext = m_pGraph->GetNodePos(path[i + 1]) - m_pGraph->GetNodePos(path[i]);
+				if (abs(toNext.x) <= 1.f && abs(toNext.y) <= 1.f)
+					flowField[path[i]] = toNext.GetNormalized();
+				else
+					m_PortalTargets[path[i]] = path[i + 1];
+			}
+		}
+	}
+
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel, class T_Heuristic>
+	inline PathMethod FlowField<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel, T_Heuristic>::ChoosePathMethod(const std::vector<int>& startCells, int destinationIdx, const PathMethodCosts& costs) const
+	{
+		//a flow field integrates and orients every cell once, weighted terrain only makes it more expensive so it's left out
+
+		std::vector<int> distinctCells = startCells;
+		std::sort(distinctCells.begin(), distinctCells.end());
+		distinctCells.erase(std::unique(distinctCells.begin(), distinctCells.end()), distinctCells.end());
+
+		const float flowFieldCost = float(m_pGraph->GetNrOfNodes());
+		const bool hasHeuristic = m_pGraph->GetAllPortalLinks().empty();
+		float aStarCost = 0.f;
+		int destinationCol, destinationRow;
+		m_pGraph->GetColRow(destinationIdx, destinationCol, destinationRow);
+		for (int startIdx : distinctCells)
+		{
+			int col, row;
+			m_pGraph->GetColRow(startIdx, col, row);
+			const float distance = float(std::max(abs(col - destinationCol), abs(row - destinationRow)) + 1);
+			const float expansions = hasHeuristic ? distance * costs.AStarExpansionsPerCell : distance * distance * costs.DijkstraExpansionsPerArea;
+			aStarCost += std::min(expansions, flowFieldCost) * costs.AStarExpansionCost;
+			if (aStarCost >= flowFieldCost)
+				return PathMethod::FlowField;
+		}
+		return PathMethod::AStar;
 	}
 
-	template <class T_NodeType, class T_ConnectionType>
-	float Elite::FlowField<T_NodeType, T_ConnectionType>::GetHeuristicCost(T_NodeType* pStartNode, T_NodeType* pEndNode) const
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel, class T_Heuristic>
+	inline float FlowField<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel, T_Heuristic>::GetHeuristicCost(int fromIdx, int toIdx) const
 	{
-		Vector2 toDestination = m_pGraph->GetNodePos(pEndNode) - m_pGraph->GetNodePos(pStartNode);
-		return m_HeuristicFunction(abs(toDestination.x), abs(toDestination.y));
+		//scaled to the cheapest step per cell of distance, cost field values start at 1
+		const float diagonalScale = m_pGraph->GetDefaultCostDiagonal() / 1.41421356f;
+		const float scale = m_pGraph->IsConnectedDiagonally() ? std::min(m_pGraph->GetDefaultCostStraight(), diagonalScale) : m_pGraph->GetDefaultCostStraight();
+		int fromCol, fromRow, toCol, toRow;
+		m_pGraph->GetColRow(fromIdx, fromCol, fromRow);
+		m_pGraph->GetColRow(toIdx, toCol, toRow);
+		return scale * m_HeuristicFunction(float(abs(toCol - fromCol)), float(abs(toRow - fromRow)));
 	}
 }
\ No newline at end of file
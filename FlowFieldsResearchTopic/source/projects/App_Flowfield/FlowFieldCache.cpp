@@ -0,0 +1,245 @@
+#include "stdafx.h"
+#include "FlowFieldCache.h"
+
+using namespace Elite;
+
+namespace
+{
+	//File layout: header, entry table, then per entry the cell costs, the flow directions and the lane costs.
+	//The table has its own checksum so a damaged table never points outside the file.
+	const char CACHE_MAGIC[4] = { 'E', 'F', 'F', 'C' };
+	const unsigned int CACHE_VERSION = 2;
+	const unsigned long long CACHE_SECTION_ALIGNMENT = 64;
+
+	unsigned long long AlignSection(unsigned long long offset)
+	{
+		return (offset + CACHE_SECTION_ALIGNMENT - 1) & ~(CACHE_SECTION_ALIGNMENT - 1);
+	}
+
+	void WritePadding(std::ofstream& file, unsigned long long offset)
+	{
+		while (static_cast<unsigned long long>(file.tellp()) < offset)
+			file.put(0);
+	}
+}
+
+struct FlowFieldCache::Header
+{
+	char Magic[4];
+	unsigned int Version;
+	int NrOfCells;
+	int NrOfEntries;
+	unsigned long long TerrainHash;
+	unsigned long long EntriesOffset;
+	unsigned long long EntriesChecksum;
+	unsigned long long FileSize;
+};
+
+struct FlowFieldCache::Entry
+{
+	int GoalIdx;
+	int LanesPerCell;
+	unsigned long long SizeClassHash;
+	unsigned long long CellCostsOffset;
+	unsigned long long FlowFieldOffset;
+	unsigned long long LaneCostsOffset;
+	unsigned long long Checksum; // of the costs, the directions and the lane costs
+};
+
+bool FlowFieldCache::Open(const std::string& filePath, unsigned long long terrainHash)
+{
+	Close();
+	m_FilePath = filePath;
+	m_TerrainHash = terrainHash;
+	if (filePath.empty() || !m_File.Open(filePath))
+		return false;
+
+	const Header* pHeader = reinterpret_cast<const Header*>(m_File.GetData());
+	if (m_File.GetSize() < sizeof(Header) || !std::equal(CACHE_MAGIC, CACHE_MAGIC + 4, pHeader->Magic)
+		|| pHeader->Version != CACHE_VERSION || pHeader->FileSize != m_File.GetSize() || pHeader->TerrainHash != terrainHash
+		|| pHeader->NrOfCells <= 0 || pHeader->NrOfEntries < 0
+		|| !m_File.Contains(pHeader->EntriesOffset, pHeader->NrOfEntries * sizeof(Entry))
+		|| Checksum(m_File.GetData() + pHeader->EntriesOffset, pHeader->NrOfEntries * sizeof(Entry)) != pHeader->EntriesChecksum)
+	{
+		Close();
+		return false;
+	}
+
+	m_pEntries = reinterpret_cast<const Entry*>(m_File.GetData() + pHeader->EntriesOffset);
+	m_NrOfEntries = pHeader->NrOfEntries;
+	m_NrOfCells = pHeader->NrOfCells;
+	m_EntryStates.assign(m_NrOfEntries, EntryState::Unchecked);
+	return true;
+}
+
+void FlowFieldCache::Close()
+{
+	m_File.Close();
+	m_pEntries = nullptr;
+	m_NrOfEntries = 0;
+	m_NrOfCells = 0;
+	m_EntryStates.clear();
+	m_AddedFields.clear();
+}
+
+bool FlowFieldCache::Find(int goalIdx, unsigned long long sizeClassHash, const float*& pCellCosts, const Vector2*& pFlowField, const float*& pLaneCosts) const
+{
+	for (const AddedField& field : m_AddedFields)
+	{
+		if (field.GoalIdx != goalIdx || field.SizeClassHash != sizeClassHash)
+			continue;
+		pCellCosts = field.CellCosts.data();
+		pFlowField = field.FlowField.data();
+		pLaneCosts = field.LaneCosts.data();
+		return true;
+	}
+
+	for (int i = 0; i < m_NrOfEntries; ++i)
+	{
+		if (m_pEntries[i].GoalIdx != goalIdx || m_pEntries[i].SizeClassHash != sizeClassHash || !IsIntact(i))
+			continue;
+		pCellCosts = reinterpret_cast<const float*>(m_File.GetData() + m_pEntries[i].CellCostsOffset);
+		pFlowField = reinterpret_cast<const Vector2*>(m_File.GetData() + m_pEntries[i].FlowFieldOffset);
+		pLaneCosts = reinterpret_cast<const float*>(m_File.GetData() + m_pEntries[i].LaneCostsOffset);
+		return true;
+	}
+	return false;
+}
+
+void FlowFieldCache::Add(int goalIdx, unsigned long long sizeClassHash, const std::vector<float>& cellCosts, const std::vector<Vector2>& flowField, const std::vector<float>& laneCosts)
+{
+	assert(cellCosts.size() == flowField.size() && !cellCosts.empty() && laneCosts.size() % cellCosts.size() == 0 && "<FlowFieldCache::Add>: fields of different grids");
+	auto it = std::find_if(m_AddedFields.begin(), m_AddedFields.end(), [goalIdx](const AddedField& field) { return field.GoalIdx == goalIdx; });
+	if (it == m_AddedFields.end())
+		it = m_AddedFields.insert(m_AddedFields.end(), AddedField{ goalIdx });
+	it->SizeClassHash = sizeClassHash;
+	it->CellCosts = cellCosts;
+	it->FlowField = flowField;
+	it->LaneCosts = laneCosts;
+}
+
+bool FlowFieldCache::Save()
+{
+	if (m_FilePath.empty())
+		return false;
+	//the mapped fields are copied out first, the file gets replaced underneath them
+	std::vector<AddedField> fields = std::move(m_AddedFields);
+	for (int i = 0; i < m_NrOfEntries; ++i)
+	{
+		const int goalIdx = m_pEntries[i].GoalIdx;
+		const bool isReplaced = std::any_of(fields.begin(), fields.end(), [goalIdx](const AddedField& field) { return field.GoalIdx == goalIdx; });
+		if (isReplaced || !IsIntact(i))
+			continue;
+
+		const float* pCellCosts = reinterpret_cast<const float*>(m_File.GetData() + m_pEntries[i].CellCostsOffset);
+		const Vector2* pFlowField = reinterpret_cast<const Vector2*>(m_File.GetData() + m_pEntries[i].FlowFieldOffset);
+		const float* pLaneCosts = reinterpret_cast<const float*>(m_File.GetData() + m_pEntries[i].LaneCostsOffset);
+		const size_t nrOfLaneCosts = size_t(m_NrOfCells) * m_pEntries[i].LanesPerCell;
+		fields.push_back({ goalIdx, m_pEntries[i].SizeClassHash, { pCellCosts, pCellCosts + m_NrOfCells }, { pFlowField, pFlowField + m_NrOfCells }, { pLaneCosts, pLaneCosts + nrOfLaneCosts } });
+	}
+	const std::string filePath = m_FilePath;
+	const unsigned long long terrainHash = m_TerrainHash;
+	Close();
+	if (fields.empty())
+		return false;
+
+	const int nrOfCells = int(fields.front().CellCosts.size());
+	Header header{};
+	std::copy(CACHE_MAGIC, CACHE_MAGIC + 4, header.Magic);
+	header.Version = CACHE_VERSION;
+	header.NrOfCells = nrOfCells;
+	header.NrOfEntries = int(fields.size());
+	header.TerrainHash = terrainHash;
+	header.EntriesOffset = AlignSection(sizeof(Header));
+
+	std::vector<Entry> entries(fields.size());
+	unsigned long long offset = AlignSection(header.EntriesOffset + entries.size() * sizeof(Entry));
+	for (size_t i = 0; i < fields.size(); ++i)
+	{
+		assert(int(fields[i].CellCosts.size()) == nrOfCells && "<FlowFieldCache::Save>: fields of different grids");
+		const size_t nrOfLaneCosts = fields[i].LaneCosts.size();
+		entries[i].GoalIdx = fields[i].GoalIdx;
+		entries[i].LanesPerCell = int(nrOfLaneCosts / nrOfCells);
+		entries[i].SizeClassHash = fields[i].SizeClassHash;
+		entries[i].CellCostsOffset = offset;
+		entries[i].FlowFieldOffset = AlignSection(offset + nrOfCells * sizeof(float));
+		entries[i].LaneCostsOffset = AlignSection(entries[i].FlowFieldOffset + nrOfCells * sizeof(Vector2));
+		unsigned long long checksum = Checksum(fields[i].CellCosts.data(), nrOfCells * sizeof(float));
+		checksum = Checksum(fields[i].FlowField.data(), nrOfCells * sizeof(Vector2), checksum);
+		entries[i].Checksum = Checksum(fields[i].LaneCosts.data(), nrOfLaneCosts * sizeof(float), checksum);
+		offset = AlignSection(entries[i].LaneCostsOffset + nrOfLaneCosts * sizeof(float));
+	}
+	header.EntriesChecksum = Checksum(entries.data(), entries.size() * sizeof(Entry));
+	header.FileSize = offset;
+
+	{
+		std::ofstream file{ filePath, std::ios::binary };
+		if (!file.is_open())
+			return false;
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+		WritePadding(file, header.EntriesOffset);
+		file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(Entry));
+		for (size_t i = 0; i < fields.size(); ++i)
+		{
+			WritePadding(file, entries[i].CellCostsOffset);
+			file.write(reinterpret_cast<const char*>(fields[i].CellCosts.data()), nrOfCells * sizeof(float));
+			WritePadding(file, entries[i].FlowFieldOffset);
+			file.write(reinterpret_cast<const char*>(fields[i].FlowField.data()), nrOfCells * sizeof(Vector2));
+			WritePadding(file, entries[i].LaneCostsOffset);
+			file.write(reinterpret_cast<const char*>(fields[i].LaneCosts.data()), fields[i].LaneCosts.size() * sizeof(float));
+		}
+		WritePadding(file, header.FileSize);
+		if (!file.good())
+			return false;
+	}
+	return Open(filePath, terrainHash);
+}
+
+unsigned long long FlowFieldCache::GetSizeClassHash(const std::vector<float>& agentRadii, int cellSize, int lanesPerCell)
+{
+	const int layout[] = { cellSize, lanesPerCell };
+	return Checksum(agentRadii.data(), agentRadii.size() * sizeof(float), Checksum(layout, sizeof(layout)));
+}
+
+unsigned long long FlowFieldCache::Checksum(const void* pData, size_t size, unsigned long long hash)
+{
+	const unsigned long long prime = 1099511628211ull;
+	const unsigned char* pBytes = static_cast<const unsigned char*>(pData);
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8)
+	{
+		unsigned long long word;
+		memcpy(&word, pBytes + i, sizeof(word));
+		hash = (hash ^ word) * prime;
+	}
+	for (; i < size; ++i)
+	{
+		hash = (hash ^ pBytes[i]) * prime;
+	}
+	return hash;
+}
+
+bool FlowFieldCache::IsIntact(int entryIdx) const
+{
+	if (m_EntryStates[entryIdx] == EntryState::Unchecked)
+	{
+		const Entry& entry = m_pEntries[entryIdx];
+		//the lane count comes from the file, it is bounded before the size is multiplied out
+		const bool areLanesBounded = entry.LanesPerCell >= 0 && static_cast<unsigned long long>(entry.LanesPerCell) <= m_File.GetSize() / (m_NrOfCells * sizeof(float));
+		const unsigned long long laneCostsSize = areLanesBounded ? static_cast<unsigned long long>(m_NrOfCells) * entry.LanesPerCell * sizeof(float) : 0;
+		const bool isInFile = areLanesBounded && m_File.Contains(entry.CellCostsOffset, m_NrOfCells * sizeof(float))
+			&& m_File.Contains(entry.FlowFieldOffset, m_NrOfCells * sizeof(Vector2))
+			&& m_File.Contains(entry.LaneCostsOffset, laneCostsSize)
+			&& entry.CellCostsOffset % alignof(float) == 0 && entry.FlowFieldOffset % alignof(Vector2) == 0 && entry.LaneCostsOffset % alignof(float) == 0;
+		bool isIntact = false;
+		if (isInFile)
+		{
+			unsigned long long checksum = Checksum(m_File.GetData() + entry.CellCostsOffset, m_NrOfCells * sizeof(float));
+			checksum = Checksum(m_File.GetData() + entry.FlowFieldOffset, m_NrOfCells * sizeof(Vector2), checksum);
+			isIntact = Checksum(m_File.GetData() + entry.LaneCostsOffset, size_t(laneCostsSize), checksum) == entry.Checksum;
+		}
+		m_EntryStates[entryIdx] = isIntact ? EntryState::Intact : EntryState::Damaged;
+	}
+	return m_EntryStates[entryIdx] == EntryState::Intact;
+}
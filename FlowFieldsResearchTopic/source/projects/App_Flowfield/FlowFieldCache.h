@@ -0,0 +1,91 @@
+#pragma once
+#include "framework\EliteAI\EliteGraphs\EGridGraph.h"
+#include "framework\EliteAI\EliteGraphs\EliteGraphUtilities\EGridMapFile.h"
+
+// Cell costs, flow directions and size class lane costs of static goals, saved so a server starts with them instead of integrating them again
+// The file is mapped and its fields used in place, every field carries a checksum that is verified on its first lookup
+// A file belongs to one terrain hash, fields saved for other terrain are never returned
+class FlowFieldCache final
+{
+public:
+	FlowFieldCache() = default;
+	~FlowFieldCache() = default;
+
+	// Starts an empty cache for the terrain when the file is missing, damaged or was saved for other terrain
+	// An empty path keeps the cache in memory only, Save then fails and keeps the added fields
+	// Returns whether fields were loaded
+	bool Open(const std::string& filePath, unsigned long long terrainHash);
+	void Close();
+	unsigned long long GetTerrainHash() const { return m_TerrainHash; }
+
+	// The costs and directions hold a value per cell, the lane costs a value per lane per cell
+	// They stay valid until the cache is closed, saved or reopened, a goal cached for other size classes is not found
+	bool Find(int goalIdx, unsigned long long sizeClassHash, const float*& pCellCosts, const Elite::Vector2*& pFlowField, const float*& pLaneCosts) const;
+	// Copied, replaces the goal's field in the file on the next Save
+	void Add(int goalIdx, unsigned long long sizeClassHash, const std::vector<float>& cellCosts, const std::vector<Elite::Vector2>& flowField, const std::vector<float>& laneCosts);
+	// Writes the intact fields of the file and the added ones to the opened path, then maps it again
+	bool Save();
+
+	// FNV-1a over 8 byte words
+	static unsigned long long Checksum(const void* pData, size_t size, unsigned long long hash = 14695981039346656037ull);
+	// Covers everything the cell costs depend on: dimensions, layout, step costs, the cost field and portal links
+	template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+	static unsigned long long GetTerrainHash(const Elite::GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>& graph);
+	// Covers what the lane costs depend on besides the terrain: the radii, the cell size they are measured in and the lanes per cell
+	static unsigned long long GetSizeClassHash(const std::vector<float>& agentRadii, int cellSize, int lanesPerCell);
+
+private:
+	struct Header;
+	struct Entry;
+	struct AddedField
+	{
+		int GoalIdx;
+		unsigned long long SizeClassHash;
+		std::vector<float> CellCosts;
+		std::vector<Elite::Vector2> FlowField;
+		std::vector<float> LaneCosts;
+	};
+	enum class EntryState : char
+	{
+		Unchecked,
+		Intact,
+		Damaged
+	};
+
+	std::string m_FilePath;
+	unsigned long long m_TerrainHash = 0;
+	Elite::EMappedFile m_File;
+	const Entry* m_pEntries = nullptr;
+	int m_NrOfEntries = 0;
+	int m_NrOfCells = 0;
+	mutable std::vector<EntryState> m_EntryStates;
+	std::vector<AddedField> m_AddedFields;
+
+	bool IsIntact(int entryIdx) const;
+
+	//C++ make the class non-copyable
+	FlowFieldCache(const FlowFieldCache&) = delete;
+	FlowFieldCache& operator=(const FlowFieldCache&) = delete;
+};
+
+template<class T_NodeType, class T_ConnectionType, class T_Connectivity, class T_CostModel>
+unsigned long long FlowFieldCache::GetTerrainHash(const Elite::GridGraph<T_NodeType, T_ConnectionType, T_Connectivity, T_CostModel>& graph)
+{
+	const float dimensions[] = { float(graph.GetColumns()), float(graph.GetRows()), float(int(graph.GetLayout())),
+		float(graph.IsConnectedDiagonally()), graph.GetDefaultCostStraight(), graph.GetDefaultCostDiagonal() };
+	unsigned long long hash = Checksum(dimensions, sizeof(dimensions));
+	hash = Checksum(graph.GetCostField(), graph.GetNrOfNodes(), hash);
+
+	//the link table is unordered
+	std::vector<Elite::GridMapPortal> links;
+	for (const auto& cellLinks : graph.GetAllPortalLinks())
+	{
+		for (const Elite::PortalLink& link : cellLinks.second)
+			links.push_back({ cellLinks.first, link.CellIdx, link.Cost });
+	}
+	std::sort(links.begin(), links.end(), [](const Elite::GridMapPortal& a, const Elite::GridMapPortal& b)
+		{
+			return a.FromIdx != b.FromIdx ? a.FromIdx < b.FromIdx : a.ToIdx < b.ToIdx;
+		});
+	return Checksum(links.data(), links.size() * sizeof(Elite::GridMapPortal), hash);
+}
@@ -0,0 +1,218 @@
+#pragma once
+#include "FlowField.h"
+
+// Landmark (ALT) lower bounds for point to point searches, see FlowField::FindPath
+// Every landmark keeps the integrated cost of all cells towards it, the triangle inequality turns two of those into a bound:
+// cost(from, to) >= cost(from, landmark) - cost(to, landmark), and the reverse difference on grids without (one way) portal links
+// Unlike the geometric heuristics the bound follows water mazes, mud and portal links
+// After terrain or portal edits the landmarks are out of date, Update re-integrates a few of them at a time and only up to date ones bound
+template<class T_NodeType, class T_ConnectionType>
+class LandmarkTable final
+{
+public:
+	enum class Selection
+	{
+		Random, // any passable cells
+		Farthest, // every landmark as far as possible from the ones before it, the first one far from a random cell
+		Border // spread evenly along the border of the grid, where most searches pass behind them
+	};
+
+	LandmarkTable(Elite::GridGraph<T_NodeType, T_ConnectionType>* pGraph);
+	~LandmarkTable() = default;
+
+	void Build(int nrOfLandmarks, Selection selection = Selection::Farthest);
+	// Re-integrates up to maxLandmarks landmarks that are out of date, returns how many are still out of date
+	int Update(int maxLandmarks = 1);
+
+	int GetNrOfLandmarks() const { return int(m_Landmarks.size()); }
+	int GetLandmark(int landmark) const { return m_Landmarks[landmark].CellIdx; }
+	bool IsUpToDate(int landmark) const;
+
+	// Lower bound on the cost of the cheapest path from fromIdx to toIdx
+	float GetHeuristicCost(int fromIdx, int toIdx) const;
+
+private:
+	struct Landmark
+	{
+		int CellIdx;
+		unsigned int CostFieldVersion;
+		unsigned int PortalLinksVersion;
+		bool IsSymmetric; // built without portal links, so the cost from the landmark equals the cost to it
+	};
+
+	Elite::GridGraph<T_NodeType, T_ConnectionType>* m_pGraph;
+	Elite::FlowField<T_NodeType, T_ConnectionType> m_Integrator; // own instance, integrating doesn't touch the portal targets of the crowd's field
+	std::vector<Landmark> m_Landmarks;
+	//interleaved per cell like the multi goal lanes, the cost of cell i to landmark k is m_Costs[i * m_LandmarksPerCell + k]
+	std::vector<float> m_Costs;
+	int m_LandmarksPerCell = 0;
+	std::vector<float> m_FieldScratch;
+
+	void Integrate(int landmark);
+	// Nearest passable cell, searched in growing squares around idx, invalid_node_index on grids without any
+	int FindPassableCell(int idx) const;
+
+	//C++ make the class non-copyable
+	LandmarkTable(const LandmarkTable&) = delete;
+	LandmarkTable& operator=(const LandmarkTable&) = delete;
+};
+
+template<class T_NodeType, class T_ConnectionType>
+LandmarkTable<T_NodeType, T_ConnectionType>::LandmarkTable(Elite::GridGraph<T_NodeType, T_ConnectionType>* pGraph)
+	: m_pGraph(pGraph)
+	, m_Integrator(pGraph)
+{
+}
+
+template<class T_NodeType, class T_ConnectionType>
+void LandmarkTable<T_NodeType, T_ConnectionType>::Build(int nrOfLandmarks, Selection selection)
+{
+	const int nrOfNodes = m_pGraph->GetNrOfNodes();
+	m_Landmarks.clear();
+	m_LandmarksPerCell = nrOfLandmarks;
+	m_Costs.assign(size_t(nrOfNodes) * nrOfLandmarks, FLT_MAX);
+	m_FieldScratch.resize(nrOfNodes);
+	if (FindPassableCell(0) == invalid_node_index)
+		return;
+
+	for (int landmark = 0; landmark < nrOfLandmarks; ++landmark)
+	{
+		int cellIdx = invalid_node_index;
+		if (selection == Selection::Random)
+		{
+			cellIdx = FindPassableCell(Elite::randomInt(nrOfNodes));
+		}
+		else if (selection == Selection::Border)
+		{
+			//up the left column, along the top row, down the right column and back along the bottom row
+			const int nrOfColumns = m_pGraph->GetColumns();
+			const int nrOfRows = m_pGraph->GetRows();
+			const int perimeter = std::max(2 * (nrOfColumns + nrOfRows) - 4, 1);
+			int col = 0, row = 0;
+			for (int step = 0; step < landmark * perimeter / nrOfLandmarks; ++step)
+			{
+				if (col == 0 && row < nrOfRows - 1)
+					++row;
+				else if (row == nrOfRows - 1 && col < nrOfColumns - 1)
+					++col;
+				else if (col == nrOfColumns - 1 && row > 0)
+					--row;
+				else
+					--col;
+			}
+			cellIdx = FindPassableCell(m_pGraph->GetIndex(col, row));
+		}
+		else
+		{
+			//farthest from the landmarks so far by their own costs, the first one is found by integrating from a random cell
+			if (landmark == 0)
+				m_Integrator.CalculateCellCosts(m_pGraph->GetNode(FindPassableCell(Elite::randomInt(nrOfNodes))), m_FieldScratch);
+			float farthestCost = -1.f;
+			for (int idx = 0; idx < nrOfNodes; ++idx)
+			{
+				float cost = FLT_MAX;
+				if (landmark == 0)
+					cost = m_FieldScratch[idx];
+				for (int k = 0; k < landmark; ++k)
+					cost = std::min(cost, m_Costs[size_t(idx) * m_LandmarksPerCell + k]);
+				if (cost != FLT_MAX && cost > farthestCost)
+				{
+					farthestCost = cost;
+					cellIdx = idx;
+				}
+			}
+		}
+
+		m_Landmarks.push_back({ cellIdx, 0, 0, false });
+		Integrate(landmark);
+	}
+}
+
+template<class T_NodeType, class T_ConnectionType>
+int LandmarkTable<T_NodeType, T_ConnectionType>::Update(int maxLandmarks)
+{
+	int nrOfOutdated = 0;
+	for (int landmark = 0; landmark < GetNrOfLandmarks(); ++landmark)
+	{
+		if (IsUpToDate(landmark))
+			continue;
+		if (maxLandmarks-- > 0)
+		{
+			//an edit can wall the landmark in, it moves to the nearest open cell
+			if (!m_pGraph->IsPassable(m_Landmarks[landmark].CellIdx))
+				m_Landmarks[landmark].CellIdx = FindPassableCell(m_Landmarks[landmark].CellIdx);
+			Integrate(landmark);
+		}
+		else
+		{
+			++nrOfOutdated;
+		}
+	}
+	return nrOfOutdated;
+}
+
+template<class T_NodeType, class T_ConnectionType>
+bool LandmarkTable<T_NodeType, T_ConnectionType>::IsUpToDate(int landmark) const
+{
+	return m_Landmarks[landmark].CostFieldVersion == m_pGraph->GetCostFieldVersion()
+		&& m_Landmarks[landmark].PortalLinksVersion == m_pGraph->GetPortalLinksVersion();
+}
+
+template<class T_NodeType, class T_ConnectionType>
+float LandmarkTable<T_NodeType, T_ConnectionType>::GetHeuristicCost(int fromIdx, int toIdx) const
+{
+	const float* fromCosts = m_Costs.data() + size_t(fromIdx) * m_LandmarksPerCell;
+	const float* toCosts = m_Costs.data() + size_t(toIdx) * m_LandmarksPerCell;
+	float bound = 0.f;
+	for (int landmark = 0; landmark < GetNrOfLandmarks(); ++landmark)
+	{
+		//a cell that can't reach the landmark bounds nothing
+		if (fromCosts[landmark] == FLT_MAX || toCosts[landmark] == FLT_MAX || !IsUpToDate(landmark))
+			continue;
+		bound = std::max(bound, fromCosts[landmark] - toCosts[landmark]);
+		if (m_Landmarks[landmark].IsSymmetric)
+			bound = std::max(bound, toCosts[landmark] - fromCosts[landmark]);
+	}
+	return bound;
+}
+
+template<class T_NodeType, class T_ConnectionType>
+void LandmarkTable<T_NodeType, T_ConnectionType>::Integrate(int landmark)
+{
+	Landmark& info = m_Landmarks[landmark];
+	info.CostFieldVersion = m_pGraph->GetCostFieldVersion();
+	info.PortalLinksVersion = m_pGraph->GetPortalLinksVersion();
+	info.IsSymmetric = m_pGraph->GetAllPortalLinks().empty();
+
+	const int nrOfNodes = m_pGraph->GetNrOfNodes();
+	if (info.CellIdx == invalid_node_index)
+		std::fill(m_FieldScratch.begin(), m_FieldScratch.end(), FLT_MAX);
+	else
+		m_Integrator.CalculateCellCosts(m_pGraph->GetNode(info.CellIdx), m_FieldScratch);
+	for (int idx = 0; idx < nrOfNodes; ++idx)
+	{
+		m_Costs[size_t(idx) * m_LandmarksPerCell + landmark] = m_FieldScratch[idx];
+	}
+}
+
+template<class T_NodeType, class T_ConnectionType>
+int LandmarkTable<T_NodeType, T_ConnectionType>::FindPassableCell(int idx) const
+{
+	int col, row;
+	m_pGraph->GetColRow(idx, col, row);
+	const int maxRadius = std::max(m_pGraph->GetColumns(), m_pGraph->GetRows());
+	for (int radius = 0; radius < maxRadius; ++radius)
+	{
+		for (int r = row - radius; r <= row + radius; ++r)
+		{
+			for (int c = col - radius; c <= col + radius; ++c)
+			{
+				//only the ring, the inside was searched before
+				const bool isOnRing = r == row - radius || r == row + radius || c == col - radius || c == col + radius;
+				if (isOnRing && m_pGraph->IsWithinBounds(c, r) && m_pGraph->IsPassable(m_pGraph->GetIndex(c, r)))
+					return m_pGraph->GetIndex(c, r);
+			}
+		}
+	}
+	return invalid_node_index;
+}
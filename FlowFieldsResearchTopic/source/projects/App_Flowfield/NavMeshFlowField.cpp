@@ -0,0 +1,340 @@
+#include "stdafx.h"
+#include "NavMeshFlowField.h"
+#include <numeric>
+
+using namespace Elite;
+
+NavMeshFlowField::NavMeshFlowField(const Polygon* pNavMesh)
+{
+	assert(pNavMesh->IsTriangulated() && "<NavMeshFlowField>: the navigation mesh has to be triangulated");
+	const std::vector<Triangle*>& triangles = pNavMesh->GetTriangles();
+	const int nrOfTriangles = int(triangles.size());
+
+	//the line matrix holds every edge once, the triangles sharing a line are neighbours across it
+	std::vector<std::array<int, 2>> lineTriangles(pNavMesh->GetLines().size(), { { invalid_node_index, invalid_node_index } });
+	m_Triangles.resize(nrOfTriangles);
+	for (int t = 0; t < nrOfTriangles; ++t)
+	{
+		const Triangle* pTriangle = triangles[t];
+		m_Triangles[t].Points = { { pTriangle->p1, pTriangle->p2, pTriangle->p3 } };
+		m_Triangles[t].Center = pTriangle->GetCenter();
+		for (int lineIdx : pTriangle->metaData.IndexLines)
+		{
+			std::array<int, 2>& shared = lineTriangles[lineIdx];
+			(shared[0] == invalid_node_index ? shared[0] : shared[1]) = t;
+		}
+	}
+	for (int t = 0; t < nrOfTriangles; ++t)
+	{
+		for (int edge = 0; edge < 3; ++edge)
+		{
+			const std::array<int, 2>& shared = lineTriangles[triangles[t]->metaData.IndexLines[edge]];
+			m_Triangles[t].Neighbours[edge] = shared[0] == t ? shared[1] : shared[0];
+		}
+	}
+
+	m_ExitEdges.assign(nrOfTriangles, invalid_node_index);
+	m_ExitCosts.assign(nrOfTriangles, FLT_MAX);
+	BuildBuckets();
+}
+
+NavMeshFlowField::NavMeshFlowField(const std::vector<Vector2>& vertices, const std::vector<int>& indices)
+{
+	const int nrOfTriangles = int(indices.size() / 3);
+	m_Triangles.resize(nrOfTriangles);
+
+	//every edge keyed by its sorted vertex indices, after sorting the two triangles sharing an edge are next to each other
+	std::vector<std::pair<unsigned long long, int>> edges(3 * nrOfTriangles);
+	for (int t = 0; t < nrOfTriangles; ++t)
+	{
+		TriangleInfo& triangle = m_Triangles[t];
+		for (int edge = 0; edge < 3; ++edge)
+		{
+			const int from = indices[3 * t + edge];
+			const int to = indices[3 * t + (edge + 1) % 3];
+			triangle.Points[edge] = vertices[from];
+			triangle.Neighbours[edge] = invalid_node_index;
+			edges[3 * t + edge] = { (static_cast<unsigned long long>(std::min(from, to)) << 32) | static_cast<unsigned int>(std::max(from, to)), 3 * t + edge };
+		}
+		triangle.Center = (triangle.Points[0] + triangle.Points[1] + triangle.Points[2]) / 3.f;
+	}
+	std::sort(edges.begin(), edges.end());
+	for (size_t i = 0; i + 1 < edges.size(); ++i)
+	{
+		if (edges[i].first != edges[i + 1].first)
+			continue;
+		const int a = edges[i].second;
+		const int b = edges[i + 1].second;
+		m_Triangles[a / 3].Neighbours[a % 3] = b / 3;
+		m_Triangles[b / 3].Neighbours[b % 3] = a / 3;
+		++i;
+	}
+
+	m_ExitEdges.assign(nrOfTriangles, invalid_node_index);
+	m_ExitCosts.assign(nrOfTriangles, FLT_MAX);
+	BuildBuckets();
+}
+
+int NavMeshFlowField::GetTriangleIndex(const Vector2& position) const
+{
+	if (m_Triangles.empty())
+		return invalid_node_index;
+
+	int col, row;
+	GetBucketColRow(position, col, row);
+	const int bucket = row * m_NrOfBucketColumns + col;
+	for (int i = m_BucketStarts[bucket]; i < m_BucketStarts[bucket + 1]; ++i)
+	{
+		const TriangleInfo& triangle = m_Triangles[m_BucketTriangles[i]];
+		if (PointInTriangle(position, triangle.Points[0], triangle.Points[1], triangle.Points[2], true))
+			return m_BucketTriangles[i];
+	}
+	return invalid_node_index;
+}
+
+void NavMeshFlowField::CalculateTriangleCosts(const Vector2& destination, std::vector<float>& triangleCosts)
+{
+	ELITE_PROFILE_SCOPE("CalculateTriangleCosts");
+	++m_Version;
+	triangleCosts.assign(m_Triangles.size(), FLT_MAX);
+	std::fill(m_ExitEdges.begin(), m_ExitEdges.end(), int(invalid_node_index));
+	std::fill(m_ExitCosts.begin(), m_ExitCosts.end(), FLT_MAX);
+	m_Destination = destination;
+	m_DestinationTriangle = GetTriangleIndex(destination);
+	if (m_DestinationTriangle == invalid_node_index)
+		return; //nothing can reach a destination off the mesh
+
+	//lowest cost on top, m_ExitCosts doubles as the closed list
+	auto isWorse = [](const SearchRecord& a, const SearchRecord& b) { return a.costSoFar > b.costSoFar; };
+	m_OpenList.clear();
+	m_OpenList.push_back({ m_DestinationTriangle, 0.f });
+	m_ExitCosts[m_DestinationTriangle] = 0.f;
+	while (!m_OpenList.empty())
+	{
+		std::pop_heap(m_OpenList.begin(), m_OpenList.end(), isWorse);
+		const SearchRecord currentRecord = m_OpenList.back();
+		m_OpenList.pop_back();
+		if (currentRecord.costSoFar > m_ExitCosts[currentRecord.triangleIdx])
+			continue; //outdated record
+
+		const TriangleInfo& current = m_Triangles[currentRecord.triangleIdx];
+		const Vector2 exitPoint = GetExitPoint(currentRecord.triangleIdx);
+		for (int edge = 0; edge < 3; ++edge)
+		{
+			const int neighbourIdx = current.Neighbours[edge];
+			if (neighbourIdx == invalid_node_index)
+				continue;
+
+			//the neighbour leaves through the shared edge, walking from its midpoint to this triangle's exit point
+			const Vector2 midpoint = (current.Points[edge] + current.Points[(edge + 1) % 3]) / 2.f;
+			const float costSoFar = currentRecord.costSoFar + Distance(midpoint, exitPoint);
+			if (costSoFar >= m_ExitCosts[neighbourIdx])
+				continue;
+
+			const std::array<int, 3>& neighbourNeighbours = m_Triangles[neighbourIdx].Neighbours;
+			m_ExitEdges[neighbourIdx] = int(std::find(neighbourNeighbours.begin(), neighbourNeighbours.end(), currentRecord.triangleIdx) - neighbourNeighbours.begin());
+			m_ExitCosts[neighbourIdx] = costSoFar;
+			m_OpenList.push_back({ neighbourIdx, costSoFar });
+			std::push_heap(m_OpenList.begin(), m_OpenList.end(), isWorse);
+		}
+	}
+
+	for (int t = 0; t < GetNrOfTriangles(); ++t)
+	{
+		if (m_ExitCosts[t] != FLT_MAX)
+			triangleCosts[t] = m_ExitCosts[t] + Distance(m_Triangles[t].Center, GetExitPoint(t));
+	}
+}
+
+void NavMeshFlowField::CreateFlowField(const std::vector<float>& triangleCosts, std::vector<Vector2>& flowField)
+{
+	ELITE_PROFILE_SCOPE("CreateNavMeshFlowField");
+	flowField.resize(m_Triangles.size());
+	for (int t = 0; t < GetNrOfTriangles(); ++t)
+	{
+		if (triangleCosts[t] == FLT_MAX)
+			flowField[t] = ZeroVector2;
+		else
+			flowField[t] = (GetSteeringTarget(m_Triangles[t].Center, t) - m_Triangles[t].Center).GetNormalized();
+	}
+}
+
+void NavMeshFlowField::SampleFlowField(const std::vector<Vector2>& positions, const std::vector<Vector2>& flowField, FlowSamples& samples) const
+{
+	samples.Cells.resize(positions.size());
+	samples.SpeedFactors.resize(positions.size());
+	samples.Directions.resize(positions.size());
+	for (size_t i = 0; i < positions.size(); ++i)
+	{
+		int triangleIdx = GetTriangleIndex(positions[i]);
+		if (triangleIdx == invalid_node_index)
+			triangleIdx = FindClosestTriangle(positions[i]);
+
+		samples.Cells[i] = triangleIdx;
+		samples.SpeedFactors[i] = 1.f;
+		const bool canReach = triangleIdx != invalid_node_index && (triangleIdx == m_DestinationTriangle || flowField[triangleIdx] != ZeroVector2);
+		samples.Directions[i] = canReach ? (GetSteeringTarget(positions[i], triangleIdx) - positions[i]).GetNormalized() : ZeroVector2;
+	}
+}
+
+Vector2 NavMeshFlowField::GetSteeringTarget(const Vector2& position, int triangleIdx) const
+{
+	if (triangleIdx == m_DestinationTriangle)
+		return m_Destination;
+	if (triangleIdx == invalid_node_index || m_ExitEdges[triangleIdx] == invalid_node_index)
+		return position;
+
+	//simple stupid funnel with its apex on the position, only the first corner is needed
+	//the last portal is the exit point of the triangle where the lookahead ends, a single point like the destination
+	Vector2 funnelRight, funnelLeft;
+	GetExitPortal(triangleIdx, funnelRight, funnelLeft);
+	for (int portal = 1; ; ++portal)
+	{
+		triangleIdx = m_Triangles[triangleIdx].Neighbours[m_ExitEdges[triangleIdx]];
+		const bool isLast = portal == m_FunnelLookahead || triangleIdx == m_DestinationTriangle;
+		Vector2 right, left;
+		if (isLast)
+			right = left = GetExitPoint(triangleIdx);
+		else
+			GetExitPortal(triangleIdx, right, left);
+
+		//a leg only moves inwards, crossing the other leg means that leg's corner comes first
+		if (Cross(funnelRight - position, right - position) >= 0.f)
+		{
+			if (Cross(right - position, funnelLeft - position) < 0.f)
+				return funnelLeft;
+			funnelRight = right;
+		}
+		if (Cross(left - position, funnelLeft - position) >= 0.f)
+		{
+			if (Cross(funnelRight - position, left - position) < 0.f)
+				return funnelRight;
+			funnelLeft = left;
+		}
+		if (isLast)
+			return funnelLeft;
+	}
+}
+
+void NavMeshFlowField::BuildBuckets()
+{
+	if (m_Triangles.empty())
+		return;
+
+	Vector2 boundsMax{ -FLT_MAX, -FLT_MAX };
+	m_BoundsMin = { FLT_MAX, FLT_MAX };
+	for (const TriangleInfo& triangle : m_Triangles)
+	{
+		for (const Vector2& point : triangle.Points)
+		{
+			m_BoundsMin = { std::min(m_BoundsMin.x, point.x), std::min(m_BoundsMin.y, point.y) };
+			boundsMax = { std::max(boundsMax.x, point.x), std::max(boundsMax.y, point.y) };
+		}
+	}
+
+	//about one triangle per bucket
+	const Vector2 size = boundsMax - m_BoundsMin;
+	const float bucketSide = std::max(sqrtf(size.x * size.y / GetNrOfTriangles()), FLT_EPSILON);
+	m_NrOfBucketColumns = std::min(int(size.x / bucketSide) + 1, 1024);
+	m_NrOfBucketRows = std::min(int(size.y / bucketSide) + 1, 1024);
+	m_BucketSize = { std::max(size.x / m_NrOfBucketColumns, FLT_EPSILON), std::max(size.y / m_NrOfBucketRows, FLT_EPSILON) };
+
+	//counted first, then filled, every bucket's triangles stay together
+	m_BucketStarts.assign(m_NrOfBucketColumns * m_NrOfBucketRows + 1, 0);
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		for (int t = 0; t < GetNrOfTriangles(); ++t)
+		{
+			const std::array<Vector2, 3>& points = m_Triangles[t].Points;
+			int minCol, minRow, maxCol, maxRow;
+			GetBucketColRow({ std::min({ points[0].x, points[1].x, points[2].x }), std::min({ points[0].y, points[1].y, points[2].y }) }, minCol, minRow);
+			GetBucketColRow({ std::max({ points[0].x, points[1].x, points[2].x }), std::max({ points[0].y, points[1].y, points[2].y }) }, maxCol, maxRow);
+			for (int row = minRow; row <= maxRow; ++row)
+			{
+				for (int col = minCol; col <= maxCol; ++col)
+				{
+					const int bucket = row * m_NrOfBucketColumns + col;
+					if (pass == 0)
+						++m_BucketStarts[bucket + 1];
+					else
+						m_BucketTriangles[m_BucketStarts[bucket]++] = t;
+				}
+			}
+		}
+
+		if (pass == 0)
+		{
+			std::partial_sum(m_BucketStarts.begin(), m_BucketStarts.end(), m_BucketStarts.begin());
+			m_BucketTriangles.resize(m_BucketStarts.back());
+		}
+		else
+		{
+			//filling moved every start to the next bucket's
+			std::rotate(m_BucketStarts.rbegin(), m_BucketStarts.rbegin() + 1, m_BucketStarts.rend());
+			m_BucketStarts[0] = 0;
+		}
+	}
+}
+
+void NavMeshFlowField::GetBucketColRow(const Vector2& position, int& col, int& row) const
+{
+	col = Clamp(int((position.x - m_BoundsMin.x) / m_BucketSize.x), 0, m_NrOfBucketColumns - 1);
+	row = Clamp(int((position.y - m_BoundsMin.y) / m_BucketSize.y), 0, m_NrOfBucketRows - 1);
+}
+
+int NavMeshFlowField::FindClosestTriangle(const Vector2& position) const
+{
+	if (m_Triangles.empty())
+		return invalid_node_index;
+
+	int col, row;
+	GetBucketColRow(position, col, row);
+	const int bucket = row * m_NrOfBucketColumns + col;
+	int closestIdx = invalid_node_index;
+	float closestDistance = FLT_MAX;
+	for (int i = m_BucketStarts[bucket]; i < m_BucketStarts[bucket + 1]; ++i)
+	{
+		const float distance = DistanceSquared(position, m_Triangles[m_BucketTriangles[i]].Center);
+		if (distance < closestDistance)
+		{
+			closestDistance = distance;
+			closestIdx = m_BucketTriangles[i];
+		}
+	}
+	return closestIdx;
+}
+
+Vector2 NavMeshFlowField::GetExitPoint(int triangleIdx) const
+{
+	if (triangleIdx == m_DestinationTriangle)
+		return m_Destination;
+	const TriangleInfo& triangle = m_Triangles[triangleIdx];
+	const int edge = m_ExitEdges[triangleIdx];
+	return (triangle.Points[edge] + triangle.Points[(edge + 1) % 3]) / 2.f;
+}
+
+void NavMeshFlowField::GetExitPortal(int triangleIdx, Vector2& right, Vector2& left) const
+{
+	const TriangleInfo& triangle = m_Triangles[triangleIdx];
+	const int edge = m_ExitEdges[triangleIdx];
+	const Vector2& start = triangle.Points[edge];
+	const Vector2& end = triangle.Points[(edge + 1) % 3];
+	const Vector2& opposite = triangle.Points[(edge + 2) % 3];
+
+	//seen from the opposite point, the right end is clockwise of the left one
+	if (Cross(end - start, opposite - start) > 0.f)
+	{
+		right = start;
+		left = end;
+	}
+	else
+	{
+		right = end;
+		left = start;
+	}
+
+	const float margin = std::min(m_CornerMargin, Distance(start, end) / 2.f);
+	const Vector2 inwards = (left - right).GetNormalized() * margin;
+	right += inwards;
+	left -= inwards;
+}
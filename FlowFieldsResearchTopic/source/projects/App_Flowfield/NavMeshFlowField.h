@@ -0,0 +1,90 @@
+#pragma once
+#include "FlowField.h"
+#include "framework\EliteGeometry\EGeometry2DTypes.h"
+#include <array>
+#include <vector>
+
+namespace Elite
+{
+	// Flow field over the triangles of a triangulated navigation mesh, open maps need orders of magnitude fewer triangles than grid cells
+	// Costs are integrated from triangle to triangle through the midpoints of the shared edges (portals), every triangle leaves through the portal it was reached by
+	// Sampling steers through a funnel over the next exit portals, agents cut straight across triangles and only turn at the corners they have to go around
+	// Cells in the samples and the flow field are triangle indices, in the order of Polygon::GetTriangles
+	class NavMeshFlowField final
+	{
+	public:
+		// The polygon has to be triangulated, its triangles and lines are copied
+		explicit NavMeshFlowField(const Polygon* pNavMesh);
+		// Three indices per triangle, e.g. from PolygonTriangulator, triangles sharing two vertex indices are neighbours
+		NavMeshFlowField(const std::vector<Vector2>& vertices, const std::vector<int>& indices);
+		~NavMeshFlowField() = default;
+
+		int GetNrOfTriangles() const { return int(m_Triangles.size()); }
+		// invalid_node_index outside the mesh
+		int GetTriangleIndex(const Vector2& position) const;
+
+		// triangleCosts gets the walking distance from every triangle's center to the destination, FLT_MAX when it can't reach it
+		void CalculateTriangleCosts(const Vector2& destination, std::vector<float>& triangleCosts);
+		// Direction from every triangle's center, zero for triangles that can't reach the destination
+		// The exit portals are those of the last CalculateTriangleCosts
+		void CreateFlowField(const std::vector<float>& triangleCosts, std::vector<Vector2>& flowField);
+
+		// Same interface as FlowField::SampleFlowField, the directions are steered per position instead of copied from the triangle
+		// Positions just off the mesh, e.g. pushed out by collisions, take the nearby triangle with the closest center
+		void SampleFlowField(const std::vector<Vector2>& positions, const std::vector<Vector2>& flowField, FlowSamples& samples) const;
+		// The mesh has no terrain, everything walkable walks at full speed
+		float GetSpeedFactor(int) const { return 1.f; }
+		// Changes whenever the triangle costs are recalculated
+		unsigned int GetVersion() const { return m_Version; }
+
+		// Number of exit portals the funnel looks ahead, more portals find corners further away
+		void SetFunnelLookahead(int nrOfPortals) { m_FunnelLookahead = std::max(nrOfPortals, 1); }
+		// Distance the funnel keeps from the corners it steers around, at most half the portal
+		void SetCornerMargin(float margin) { m_CornerMargin = std::max(margin, 0.f); }
+		// Point an agent on position in triangleIdx walks straight towards, the destination itself when nothing is in the way
+		Vector2 GetSteeringTarget(const Vector2& position, int triangleIdx) const;
+
+	private:
+		struct TriangleInfo
+		{
+			std::array<Vector2, 3> Points; // edge k runs from point k to point k + 1
+			std::array<int, 3> Neighbours; // across edge k, invalid_node_index on the mesh border
+			Vector2 Center;
+		};
+		struct SearchRecord
+		{
+			int triangleIdx;
+			float costSoFar;
+		};
+
+		std::vector<TriangleInfo> m_Triangles;
+		std::vector<int> m_ExitEdges; // edge a triangle leaves through, invalid_node_index for the destination's triangle and unreachable ones
+		std::vector<float> m_ExitCosts; // from the midpoint of the exit edge (the destination itself for its triangle) to the destination
+		std::vector<SearchRecord> m_OpenList;
+		Vector2 m_Destination;
+		int m_DestinationTriangle = invalid_node_index;
+		int m_FunnelLookahead = 4;
+		float m_CornerMargin = 0.f;
+		unsigned int m_Version = 0;
+
+		//uniform buckets over the mesh bounds, each lists the triangles whose bounds overlap it
+		Vector2 m_BoundsMin;
+		Vector2 m_BucketSize;
+		int m_NrOfBucketColumns = 0;
+		int m_NrOfBucketRows = 0;
+		std::vector<int> m_BucketStarts; // triangles of bucket b are m_BucketTriangles[m_BucketStarts[b], m_BucketStarts[b + 1])
+		std::vector<int> m_BucketTriangles;
+
+		void BuildBuckets();
+		void GetBucketColRow(const Vector2& position, int& col, int& row) const; // clamped to the buckets
+		// Closest center among the triangles of the position's bucket, for positions just off the mesh
+		int FindClosestTriangle(const Vector2& position) const;
+		Vector2 GetExitPoint(int triangleIdx) const;
+		// Right and left end of the triangle's exit edge seen from inside, moved inwards by the corner margin
+		void GetExitPortal(int triangleIdx, Vector2& right, Vector2& left) const;
+
+		//C++ make the class non-copyable
+		NavMeshFlowField(const NavMeshFlowField&) = delete;
+		NavMeshFlowField& operator=(const NavMeshFlowField&) = delete;
+	};
+}
@@ -2,9 +2,12 @@
 #include "stdafx.h"
 #include "Obstacle.h"
 
-Obstacle::Obstacle(Elite::Vector2 center, float radius)
+Obstacle::Obstacle(Elite::Vector2 center, float radius, bool createRigidBody)
 	:m_Center(center), m_Radius(radius)
 {
+	if (!createRigidBody)
+		return;
+
 	//Create Rigidbody
 	const Elite::RigidBodyDefine define = Elite::RigidBodyDefine(0.01f, 0.1f, Elite::eStatic, false);
 	const Transform transform = Transform(center, Elite::ZeroVector2);
@@ -1,9 +1,11 @@
+#pragma once
 // Steering behavior obstacle
 
 class Obstacle final
 {
 public:
-	Obstacle(Elite::Vector2 center, float radius);
+	// Obstacles without a rigidbody only take part in steering, their collision is provided elsewhere
+	Obstacle(Elite::Vector2 center, float radius, bool createRigidBody = true);
 	~Obstacle();
 
 	Elite::Vector2 GetCenter() const { return m_Center; }
@@ -0,0 +1,191 @@
+#include "stdafx.h"
+#include "ObstacleGrid.h"
+
+ObstacleGrid::ObstacleGrid(int columns, int rows, float cellSize)
+	: m_NrOfColumns(columns)
+	, m_NrOfRows(rows)
+	, m_CellSize(cellSize)
+	, m_CellObstacles(columns * rows, nullptr)
+	, m_DenseIndices(columns * rows, -1)
+	, m_NrOfChunkColumns((columns + CHUNK_SIZE - 1) / CHUNK_SIZE)
+	, m_NrOfChunkRows((rows + CHUNK_SIZE - 1) / CHUNK_SIZE)
+{
+	m_Chunks.resize(m_NrOfChunkColumns * m_NrOfChunkRows);
+}
+
+ObstacleGrid::~ObstacleGrid()
+{
+	Clear();
+	for (BodyChunk& chunk : m_Chunks)
+	{
+		SAFE_DELETE(chunk.pBody);
+	}
+}
+
+bool ObstacleGrid::Add(int cellIdx, Elite::Vector2 center, float radius)
+{
+	if (m_CellObstacles[cellIdx])
+		return false;
+
+	Obstacle* pObstacle = new Obstacle{ center, radius, false };
+	m_CellObstacles[cellIdx] = pObstacle;
+	m_DenseIndices[cellIdx] = int(m_Obstacles.size());
+	m_Obstacles.push_back(pObstacle);
+	m_DenseCells.push_back(cellIdx);
+	MarkChunkDirty(cellIdx);
+	return true;
+}
+
+bool ObstacleGrid::Remove(int cellIdx)
+{
+	Obstacle* pObstacle = m_CellObstacles[cellIdx];
+	if (!pObstacle)
+		return false;
+
+	//swap remove from the dense list
+	int denseIdx = m_DenseIndices[cellIdx];
+	m_Obstacles[denseIdx] = m_Obstacles.back();
+	m_DenseCells[denseIdx] = m_DenseCells.back();
+	m_DenseIndices[m_DenseCells[denseIdx]] = denseIdx;
+	m_Obstacles.pop_back();
+	m_DenseCells.pop_back();
+
+	m_CellObstacles[cellIdx] = nullptr;
+	m_DenseIndices[cellIdx] = -1;
+	SAFE_DELETE(pObstacle);
+	MarkChunkDirty(cellIdx);
+	return true;
+}
+
+void ObstacleGrid::Clear()
+{
+	for (size_t i = 0; i < m_Obstacles.size(); i++)
+	{
+		MarkChunkDirty(m_DenseCells[i]);
+		SAFE_DELETE(m_Obstacles[i]);
+	}
+	m_Obstacles.clear();
+	m_DenseCells.clear();
+	std::fill(m_CellObstacles.begin(), m_CellObstacles.end(), nullptr);
+	std::fill(m_DenseIndices.begin(), m_DenseIndices.end(), -1);
+}
+
+Obstacle* ObstacleGrid::FindClosest(const Elite::Vector2& pos, float maxDistance) const
+{
+	Obstacle* pClosest = nullptr;
+	float closestDistanceSquared = maxDistance * maxDistance;
+	ForEachInRange(
+		int(floorf((pos.x - maxDistance) / m_CellSize)), int(floorf((pos.y - maxDistance) / m_CellSize)),
+		int(floorf((pos.x + maxDistance) / m_CellSize)), int(floorf((pos.y + maxDistance) / m_CellSize)),
+		[&pos, &pClosest, &closestDistanceSquared](Obstacle* pObstacle)
+		{
+			float distanceSquared = Elite::DistanceSquared(pos, pObstacle->GetCenter());
+			if (distanceSquared < closestDistanceSquared)
+			{
+				closestDistanceSquared = distanceSquared;
+				pClosest = pObstacle;
+			}
+		});
+	return pClosest;
+}
+
+void ObstacleGrid::RebuildDirtyBodies(int maxChunks)
+{
+	int nrOfRebuilds = maxChunks < 0 ? int(m_DirtyChunks.size()) : std::min(maxChunks, int(m_DirtyChunks.size()));
+	for (int i = 0; i < nrOfRebuilds; ++i)
+	{
+		RebuildChunk(m_DirtyChunks[i]);
+	}
+	m_DirtyChunks.erase(m_DirtyChunks.begin(), m_DirtyChunks.begin() + nrOfRebuilds);
+}
+
+int ObstacleGrid::GetNrOfBodies() const
+{
+	return int(std::count_if(m_Chunks.begin(), m_Chunks.end(), [](const BodyChunk& chunk) { return chunk.pBody != nullptr; }));
+}
+
+int ObstacleGrid::GetNrOfBodyShapes() const
+{
+	int nrOfShapes = 0;
+	for (const BodyChunk& chunk : m_Chunks)
+	{
+		nrOfShapes += int(chunk.shapes.size());
+	}
+	return nrOfShapes;
+}
+
+void ObstacleGrid::MarkChunkDirty(int cellIdx)
+{
+	int chunkIdx = (cellIdx / m_NrOfColumns / CHUNK_SIZE) * m_NrOfChunkColumns + (cellIdx % m_NrOfColumns) / CHUNK_SIZE;
+	if (!m_Chunks[chunkIdx].isDirty)
+	{
+		m_Chunks[chunkIdx].isDirty = true;
+		m_DirtyChunks.push_back(chunkIdx);
+	}
+}
+
+void ObstacleGrid::RebuildChunk(int chunkIdx)
+{
+	BodyChunk& chunk = m_Chunks[chunkIdx];
+	chunk.isDirty = false;
+	SAFE_DELETE(chunk.pBody);
+	chunk.shapes.clear();
+
+	const int minCol = (chunkIdx % m_NrOfChunkColumns) * CHUNK_SIZE;
+	const int minRow = (chunkIdx / m_NrOfChunkColumns) * CHUNK_SIZE;
+	const int width = std::min(CHUNK_SIZE, m_NrOfColumns - minCol);
+	const int height = std::min(CHUNK_SIZE, m_NrOfRows - minRow);
+
+	//Greedy meshing: grow each unclaimed obstacle cell into the widest, then tallest, rectangle of unclaimed obstacle cells
+	bool claimed[CHUNK_SIZE][CHUNK_SIZE] = {};
+	auto isFree = [this, &claimed, minCol, minRow](int c, int r) {
+		return !claimed[r][c] && m_CellObstacles[(minRow + r) * m_NrOfColumns + minCol + c] != nullptr;
+	};
+
+	const Elite::Vector2 chunkOrigin{ minCol * m_CellSize, minRow * m_CellSize };
+	for (int r = 0; r < height; ++r)
+	{
+		for (int c = 0; c < width; ++c)
+		{
+			if (!isFree(c, r))
+				continue;
+
+			int rectWidth = 1;
+			while (c + rectWidth < width && isFree(c + rectWidth, r))
+				++rectWidth;
+
+			int rectHeight = 1;
+			bool canGrow = true;
+			while (canGrow && r + rectHeight < height)
+			{
+				for (int i = 0; i < rectWidth && canGrow; ++i)
+					canGrow = isFree(c + i, r + rectHeight);
+				if (canGrow)
+					++rectHeight;
+			}
+
+			for (int y = r; y < r + rectHeight; ++y)
+				for (int x = c; x < c + rectWidth; ++x)
+					claimed[y][x] = true;
+
+			//vertices are relative to the body, which sits on the chunk origin
+			const Elite::Vector2 bottomLeft{ c * m_CellSize, r * m_CellSize };
+			const Elite::Vector2 topRight{ (c + rectWidth) * m_CellSize, (r + rectHeight) * m_CellSize };
+			Elite::EPhysicsPolygonShape shape;
+			shape.center = (bottomLeft + topRight) / 2.f;
+			shape.vertices = { bottomLeft, { topRight.x, bottomLeft.y }, topRight, { bottomLeft.x, topRight.y } };
+			shape.normals = { { 0.f, -1.f }, { 1.f, 0.f }, { 0.f, 1.f }, { -1.f, 0.f } };
+			chunk.shapes.push_back(shape);
+		}
+	}
+
+	if (chunk.shapes.empty())
+		return;
+
+	const Elite::RigidBodyDefine define = Elite::RigidBodyDefine(0.01f, 0.1f, Elite::eStatic, false);
+	chunk.pBody = new RigidBody(define, Transform(chunkOrigin, Elite::ZeroVector2));
+	for (Elite::EPhysicsPolygonShape& shape : chunk.shapes)
+	{
+		chunk.pBody->AddShape(&shape);
+	}
+}
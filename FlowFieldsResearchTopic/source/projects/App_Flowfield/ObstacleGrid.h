@@ -0,0 +1,86 @@
+#pragma once
+#include "Obstacle.h"
+#include <vector>
+
+// Owns the obstacles of a grid, indexed by the cell they are standing on (row major: row * columns + col)
+// Collision is not done per obstacle: the cells of each chunk are merged into a few rectangles on one static body
+class ObstacleGrid final
+{
+public:
+	ObstacleGrid(int columns, int rows, float cellSize);
+	~ObstacleGrid();
+
+	// O(1), returns false when the cell already has an obstacle
+	bool Add(int cellIdx, Elite::Vector2 center, float radius);
+	// O(1), returns false when the cell has no obstacle
+	bool Remove(int cellIdx);
+	void Clear();
+
+	Obstacle* Get(int cellIdx) const { return m_CellObstacles[cellIdx]; }
+	const std::vector<Obstacle*>& GetObstacles() const { return m_Obstacles; }
+	int GetNrOfObstacles() const { return int(m_Obstacles.size()); }
+
+	// Calls func(Obstacle*) for every obstacle in the inclusive cell range, the range is clamped to the grid
+	template<class T_Func>
+	void ForEachInRange(int minCol, int minRow, int maxCol, int maxRow, T_Func func) const;
+
+	// Closest obstacle whose center lies within maxDistance of pos, only the cells overlapping that distance are visited
+	Obstacle* FindClosest(const Elite::Vector2& pos, float maxDistance) const;
+
+	// Rebuilds the static bodies of chunks whose cells changed, at most maxChunks per call (-1 = all)
+	// Meant to be called once per frame so big edits are spread over several frames
+	void RebuildDirtyBodies(int maxChunks = -1);
+	bool HasDirtyBodies() const { return !m_DirtyChunks.empty(); }
+	int GetNrOfBodies() const;
+	int GetNrOfBodyShapes() const;
+
+private:
+	static const int CHUNK_SIZE = 16; // in cells
+
+	struct BodyChunk
+	{
+		RigidBody* pBody = nullptr;
+		std::vector<Elite::EPhysicsPolygonShape> shapes; // the rigidbody keeps pointers to these
+		bool isDirty = false;
+	};
+
+	int m_NrOfColumns;
+	int m_NrOfRows;
+	float m_CellSize;
+
+	std::vector<Obstacle*> m_CellObstacles; // one slot per cell
+	std::vector<Obstacle*> m_Obstacles; // dense list for iteration
+	std::vector<int> m_DenseIndices; // position of each cell's obstacle in m_Obstacles
+	std::vector<int> m_DenseCells; // cell of each obstacle in m_Obstacles
+
+	int m_NrOfChunkColumns;
+	int m_NrOfChunkRows;
+	std::vector<BodyChunk> m_Chunks;
+	std::vector<int> m_DirtyChunks;
+
+	void MarkChunkDirty(int cellIdx);
+	void RebuildChunk(int chunkIdx);
+
+	//C++ make the class non-copyable
+	ObstacleGrid(const ObstacleGrid&) = delete;
+	ObstacleGrid& operator=(const ObstacleGrid&) = delete;
+};
+
+template<class T_Func>
+void ObstacleGrid::ForEachInRange(int minCol, int minRow, int maxCol, int maxRow, T_Func func) const
+{
+	minCol = std::max(minCol, 0);
+	minRow = std::max(minRow, 0);
+	maxCol = std::min(maxCol, m_NrOfColumns - 1);
+	maxRow = std::min(maxRow, m_NrOfRows - 1);
+
+	for (int r = minRow; r <= maxRow; ++r)
+	{
+		for (int c = minCol; c <= maxCol; ++c)
+		{
+			Obstacle* pObstacle = m_CellObstacles[r * m_NrOfColumns + c];
+			if (pObstacle)
+				func(pObstacle);
+		}
+	}
+}
@@ -16,11 +16,24 @@
 class ISteeringBehavior;
 class Obstacle;
 
+// Flow field data of the cell the agent is in, only refreshed when the agent leaves the cell or the field changes
+struct AgentCellCache
+{
+	int CellIdx = invalid_node_index;
+	Elite::Vector2 CellMin{}; // world bounds of the cell, open ended on the grid border
+	Elite::Vector2 CellMax{};
+	unsigned int FieldVersion = 0;
+	Elite::Vector2 Direction{};
+	float SpeedFactor = 1.f;
+
+	bool Contains(const Elite::Vector2& pos) const { return pos.x >= CellMin.x && pos.x < CellMax.x && pos.y >= CellMin.y && pos.y < CellMax.y; }
+};
+
 class SteeringAgent final : public BaseAgent
 {
 public:
 	//--- Constructor & Destructor ---
-	SteeringAgent() = default;
+	SteeringAgent(float radius = 1.f) : BaseAgent(radius) {}
 	virtual ~SteeringAgent() = default;
 
 	//--- Agent Functions ---
@@ -48,10 +61,14 @@ public:
 
 	void SetObstacleVector(std::vector<Obstacle*>* obstacles);
 
+	const AgentCellCache& GetCellCache() const { return m_CellCache; }
+	AgentCellCache& GetCellCache() { return m_CellCache; }
+
 private:
 	//--- Datamembers ---
 	ISteeringBehavior* m_pSteeringBehavior = nullptr;
 	std::vector<Obstacle*>* m_pObstacles = nullptr;
+	AgentCellCache m_CellCache;
 
 	float m_MaxLinearSpeed = 10.f;
 	float m_MaxAngularSpeed = 30.f;
@@ -1,10 +0,0 @@
-#pragma once
-#include "framework\EliteMath\EMath.h"
-#include "framework\EliteMath\EMathUtilities.h"
-#include <utility>
-
-struct TeleporterPair
-{
-	std::pair<int, int> PositionIndices{-1,-1};
-	int Closest{-1};
-};
\ No newline at end of file
@@ -170,6 +170,10 @@ extern bool gRequestShutdown;
 #include "framework/EliteHelpers/ESingleton.h"
 #include "framework/EliteHelpers/EMemoryPool.h"
 #include "framework/EliteHelpers/EMulticastDelegate.h"
+#include "framework/EliteHelpers/EProfiler.h"
+#include "framework/EliteHelpers/ESessionLog.h"
+#include "framework/EliteHelpers/EWorkerPool.h"
+#include "framework/EliteHelpers/EMappedFile.h"
 #include "framework/EliteMath/EMath.h"
 #include "framework/ElitePhysics/EPhysics.h"
 #include "framework/EliteInput/EInputCodes.h"
@@ -188,6 +192,7 @@ extern bool gRequestShutdown;
 #define TIMER Elite::ETimer<PLATFORM_ID>::GetInstance()
 #define DEBUGRENDERER2D EliteDebugRenderer2D::GetInstance()
 #define PHYSICSWORLD PhysicsWorld::GetInstance()
+#define PROFILER Elite::EProfiler::GetInstance()
 
 /* --- PLATFORM SPECIFIC INCLUDES --- */
 #pragma region PlatformIncludes